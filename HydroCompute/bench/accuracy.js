@@ -0,0 +1,291 @@
+/**
+ * @namespace accuracyBench
+ * @description Differential accuracy harness. Runs every implementation of the operations of the cost model
+ * (JavaScript, AssemblyScript, C compiled to Web Assembly and C compiled natively with -march=native) over reference
+ * datasets, and compares their outputs with double precision oracles (oracles.js) evaluated over the same float32
+ * inputs. The error of each implementation is reported next to its throughput, so faster kernels (vectorized,
+ * reordered reductions, single precision accumulators) can be checked for the accuracy they give up.
+ *
+ * Reference datasets:
+ * - typical: streamflow series and matrices with entries in [-0.5, 0.5).
+ * - long: series ten times longer (four for the quadratic kernels) and matrices with twice the side.
+ * - offset: small fluctuations over a large mean, ill-conditioned for means, variances and trends.
+ * - wide: strictly positive values spanning eight orders of magnitude, and matrices with entries scaled by powers of
+ *   ten so that their products cancel.
+ *
+ * Errors, over the values where the oracle is finite:
+ * - maxAbs: largest absolute error.
+ * - maxRel: largest relative error, relative to the value or to 1e-6 of the largest value, whichever is larger.
+ * - normRel: largest absolute error over the largest value of the oracle.
+ * - digits: significant digits, -log10(normRel).
+ *
+ * Usage:
+ *   node bench/accuracy.js [--ops op[,op...]] [--engines engine[,engine...]] [--datasets name[,name...]] [--reps n]
+ *                          [--seed n] [--max-error x] [--baseline file] [--factor x] [--json file]
+ *
+ * Entries with a normRel above --max-error are flagged. With --baseline, the normRel of each entry is compared with
+ * the one saved by a previous --json run, and the script exits with 1 if any grew by more than --factor.
+ */
+import { operations } from "../src/core/utils/costModel.js";
+import { layouts, oracles } from "./oracles.js";
+import { median, runners } from "./runners.js";
+import { matrixPair, offsetSeries, scaledMatrixPair, streamflow, wideRange } from "./synthetic.js";
+
+/**
+ * @description Sizes of the typical datasets: values per series, values for the quadratic kernels and side of the
+ * matrices. Long datasets scale them up.
+ * @memberof accuracyBench
+ */
+const sizes = { series: 100000, quadratic: 2000, side: 128 };
+
+//Errors under this floor are rounding noise, and are not flagged as regressions
+const noiseFloor = 1e-7;
+
+/**
+ * @description Inputs of an operation for each reference dataset, in the layout of the engine data.
+ * @memberof accuracyBench
+ */
+const datasets = {
+  typical: (op, seed) =>
+    op.startsWith("matrix")
+      ? { data: matrixPair(sizes.side, seed), length: 2 }
+      : { data: streamflow(op === "acf" ? sizes.quadratic : sizes.series, seed), length: 1 },
+  long: (op, seed) =>
+    op.startsWith("matrix")
+      ? { data: matrixPair(2 * sizes.side, seed), length: 2 }
+      : { data: streamflow(op === "acf" ? 4 * sizes.quadratic : 10 * sizes.series, seed), length: 1 },
+  offset: (op, seed) =>
+    op.startsWith("matrix") ? null : { data: offsetSeries(op === "acf" ? sizes.quadratic : sizes.series, seed), length: 1 },
+  wide: (op, seed) =>
+    op.startsWith("matrix")
+      ? { data: scaledMatrixPair(sizes.side, seed), length: 2 }
+      : { data: wideRange(op === "acf" ? sizes.quadratic : sizes.series, seed), length: 1 },
+};
+
+/**
+ * @description Name of an implementation as reported, separating the C builds from the AssemblyScript ones.
+ * @memberof accuracyBench
+ */
+const implementationOf = (engine, funcName) =>
+  engine === "javascript"
+    ? "js"
+    : engine === "native"
+    ? "c-native"
+    : funcName.startsWith("_")
+    ? "c-wasm"
+    : "as-wasm";
+
+const parseArgs = (argv) => {
+  const args = {
+    reps: 3,
+    seed: 1,
+    ops: null,
+    engines: ["javascript", "wasm", "native"],
+    datasets: Object.keys(datasets),
+    json: null,
+    baseline: null,
+    factor: 2,
+    "max-error": 1e-3,
+  };
+  for (let i = 2; i < argv.length; i += 2) {
+    const [key, value] = [argv[i].replace(/^--/, ""), argv[i + 1]];
+    if (key === "help" || typeof value === "undefined") {
+      console.log(
+        "Usage: node bench/accuracy.js [--ops op,...] [--engines engine,...] [--datasets name,...] [--reps n] [--seed n] [--max-error x] [--baseline file] [--factor x] [--json file]"
+      );
+      process.exit(key === "help" ? 0 : 1);
+    }
+    args[key] = ["ops", "engines", "datasets"].includes(key)
+      ? value.split(",")
+      : ["json", "baseline"].includes(key)
+      ? value
+      : Number(value);
+  }
+  return args;
+};
+
+/**
+ * @method compare
+ * @memberof accuracyBench
+ * @description Errors of an output against its oracle, over their common length.
+ * @param {Float32Array} output - output of the implementation
+ * @param {Float64Array} reference - output of the oracle
+ * @returns {Object} maxAbs, maxRel, normRel, digits, the count of non-finite outputs and a note on mismatches or
+ * references without finite values
+ */
+const compare = (output, reference) => {
+  const n = Math.min(output.length, reference.length);
+  let scale = 0;
+  for (let i = 0; i < n; i++) Number.isFinite(reference[i]) ? (scale = Math.max(scale, Math.abs(reference[i]))) : null;
+  const floor = scale * 1e-6 || Number.MIN_VALUE;
+  let maxAbs = 0,
+    maxRel = 0,
+    nonFinite = 0,
+    compared = 0;
+  for (let i = 0; i < n; i++) {
+    if (!Number.isFinite(reference[i])) continue;
+    compared += 1;
+    if (!Number.isFinite(output[i])) {
+      nonFinite += 1;
+      continue;
+    }
+    const error = Math.abs(output[i] - reference[i]);
+    maxAbs = Math.max(maxAbs, error);
+    maxRel = Math.max(maxRel, error / Math.max(Math.abs(reference[i]), floor));
+  }
+  const normRel = nonFinite > 0 ? Infinity : scale > 0 ? maxAbs / scale : maxAbs;
+  return {
+    maxAbs,
+    maxRel,
+    normRel,
+    digits: normRel > 0 ? -Math.log10(normRel) : Infinity,
+    nonFinite,
+    note:
+      compared === 0
+        ? "no finite reference values"
+        : output.length !== reference.length
+        ? `length ${output.length}, expected ${reference.length}`
+        : null,
+  };
+};
+
+/**
+ * @method accuracy
+ * @memberof accuracyBench
+ * @description Runs every implementation of the selected operations over the reference datasets.
+ * @param {Object} args - see the usage of the script
+ * @returns {Promise<Array>} one entry per operation, dataset and implementation
+ */
+const accuracy = async (args) => {
+  const results = [];
+  for (const op of args.ops || Object.keys(operations)) {
+    if (!(op in oracles)) continue;
+    const inputs = args.datasets
+      .map((name) => ({ name, input: datasets[name](op, args.seed) }))
+      .filter(({ input }) => input !== null)
+      .map(({ name, input }) => ({ name, ...input, reference: oracles[op](Float64Array.from(input.data)) }));
+    for (const { engine, funcName } of operations[op].implementations) {
+      if (!args.engines.includes(engine) || !(engine in runners)) continue;
+      let runner;
+      try {
+        runner = await runners[engine](funcName);
+      } catch (error) {
+        console.error(`Skipping ${engine}:${funcName}, the engine could not be loaded. ${error.message}`);
+        continue;
+      }
+      if (runner === null) continue;
+      for (const { name, data, length, reference } of inputs) {
+        const entry = { op, dataset: name, implementation: implementationOf(engine, funcName), engine, funcName };
+        try {
+          const kernel = [];
+          let output;
+          for (let r = 0; r < args.reps; r++) {
+            const call = runner.call(data, length);
+            output = call.output;
+            kernel.push(call.kernel);
+          }
+          const k = median(kernel),
+            expected = funcName in layouts ? layouts[funcName](reference) : reference;
+          results.push({
+            ...entry,
+            size: data.length,
+            ...compare(output, expected),
+            kernel_ms: k,
+            throughput: data.length / (k / 1000),
+          });
+        } catch (e) {
+          results.push({ ...entry, size: data.length, error: e.message });
+        }
+      }
+    }
+  }
+  return results;
+};
+
+/**
+ * @method check
+ * @memberof accuracyBench
+ * @description Flags the entries above the error threshold, and those whose error grew against a baseline.
+ * @param {Array} results - results of accuracy
+ * @param {Array|null} baseline - results of a previous run
+ * @param {Object} args - see the usage of the script
+ * @returns {Array} the regressions found
+ */
+const check = (results, baseline, { factor, "max-error": maxError }) => {
+  const key = (r) => `${r.op}/${r.dataset}/${r.engine}:${r.funcName}`,
+    previous = new Map((baseline || []).map((r) => [key(r), r])),
+    regressions = [];
+  for (const r of results) {
+    r.flagged = typeof r.error !== "undefined" || r.normRel > maxError;
+    const before = previous.get(key(r));
+    if (typeof before === "undefined" || typeof r.error !== "undefined") continue;
+    const limit = Math.max(noiseFloor, (before.normRel ?? Infinity) * factor);
+    if (r.normRel > limit) {
+      r.regression = before.normRel;
+      regressions.push(r);
+    }
+  }
+  return regressions;
+};
+
+/**
+ * @method table
+ * @memberof accuracyBench
+ * @description Comparison table of the results, grouped by operation and dataset, most accurate first.
+ * @param {Array} results - results of accuracy
+ * @returns {String} table
+ */
+const table = (results) => {
+  const exp = (value) => (typeof value === "number" ? value.toExponential(2) : "-"),
+    rows = [["operation", "dataset", "impl", "function", "max abs", "max rel", "norm rel", "digits", "values/s", ""]];
+  const sorted = [...results].sort(
+    (a, b) =>
+      a.op.localeCompare(b.op) || a.dataset.localeCompare(b.dataset) || (a.normRel ?? Infinity) - (b.normRel ?? Infinity)
+  );
+  for (const r of sorted) {
+    const notes = [
+      r.error ? `error: ${r.error}` : null,
+      r.nonFinite > 0 ? `${r.nonFinite} non-finite` : null,
+      r.note,
+      typeof r.regression === "number" ? `REGRESSION from ${exp(r.regression)}` : null,
+      r.flagged && !r.error ? "FLAGGED" : null,
+    ].filter((n) => n !== null);
+    rows.push([
+      r.op,
+      r.dataset,
+      r.implementation,
+      r.funcName,
+      exp(r.maxAbs),
+      exp(r.maxRel),
+      exp(r.normRel),
+      typeof r.digits === "number" ? r.digits.toFixed(1) : "-",
+      exp(r.throughput),
+      notes.join(", "),
+    ]);
+  }
+  const widths = rows[0].map((_, c) => Math.max(...rows.map((row) => row[c].length)));
+  return rows.map((row) => row.map((cell, c) => cell.padEnd(widths[c])).join("  ").trimEnd()).join("\n");
+};
+
+const args = parseArgs(process.argv);
+const results = await accuracy(args);
+let baseline = null;
+if (args.baseline !== null) {
+  const { readFile } = await import("node:fs/promises");
+  baseline = JSON.parse(await readFile(args.baseline, "utf8")).results;
+}
+const regressions = check(results, baseline, args);
+console.log(table(results));
+if (args.json !== null) {
+  const { writeFile } = await import("node:fs/promises");
+  //JSON has no Infinity, non-finite errors are saved as null
+  await writeFile(
+    args.json,
+    JSON.stringify({ node: process.versions.node, seed: args.seed, results }, (_, v) =>
+      typeof v === "number" && !Number.isFinite(v) ? null : v, 2)
+  );
+}
+if (regressions.length > 0) {
+  console.error(`${regressions.length} implementation(s) lost accuracy against ${args.baseline}.`);
+  process.exit(1);
+}
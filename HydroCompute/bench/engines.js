@@ -0,0 +1,152 @@
+/**
+ * @namespace engineBench
+ * @description Headless cross-engine benchmark. Loads the kernels of each engine in the main thread of Node.js and
+ * feeds the equivalent implementations of every operation of the cost model (e.g. matrixMultiply_js, AS
+ * matrixMultiplication and matrixMultiply_c) the same seeded datasets. Each call goes through the same path as in
+ * the engine workers, and its time is split into:
+ * - instantiation: loading and instantiating the module (Web Assembly) or the addon (native), measured per module.
+ * - marshalling: copying the inputs into and the outputs out of the engine (Web Assembly heaps, typed array
+ *   conversions of the JavaScript worker), i.e. the wall time of the call minus the kernel.
+ * - kernel: the time between the start-function and end-function marks of the workers, or the time reported by the
+ *   native addon.
+ *
+ * Usage:
+ *   node bench/engines.js [--ops op[,op...]] [--engines engine[,engine...]] [--sizes n[,n...]] [--reps n]
+ *                         [--seed n] [--json file]
+ *
+ * Sizes are values per series, or elements per matrix. Without --sizes, each operation runs over its default sizes.
+ */
+import { operations } from "../src/core/utils/costModel.js";
+import { median, runners } from "./runners.js";
+import { dataset } from "./synthetic.js";
+
+/**
+ * @description Default sizes of each operation. Quadratic kernels run over shorter series.
+ * @memberof engineBench
+ */
+const defaultSizes = {
+  matrix: [64 * 64, 128 * 128, 256 * 256],
+  quadratic: [1000, 4000, 16000],
+  series: [10000, 100000, 1000000],
+};
+
+const sizesOf = (op) =>
+  op.startsWith("matrix") ? defaultSizes.matrix : op === "acf" ? defaultSizes.quadratic : defaultSizes.series;
+
+const parseArgs = (argv) => {
+  const args = { reps: 5, seed: 1, ops: null, engines: ["javascript", "wasm", "native"], sizes: null, json: null };
+  for (let i = 2; i < argv.length; i += 2) {
+    const [key, value] = [argv[i].replace(/^--/, ""), argv[i + 1]];
+    if (key === "help" || typeof value === "undefined") {
+      console.log(
+        "Usage: node bench/engines.js [--ops op,...] [--engines engine,...] [--sizes n,...] [--reps n] [--seed n] [--json file]"
+      );
+      process.exit(key === "help" ? 0 : 1);
+    }
+    args[key] = ["ops", "engines"].includes(key)
+      ? value.split(",")
+      : key === "sizes"
+      ? value.split(",").map(Number)
+      : key === "json"
+      ? value
+      : Number(value);
+  }
+  return args;
+};
+
+/**
+ * @method benchmark
+ * @memberof engineBench
+ * @description Runs every implementation of the selected operations over the given sizes.
+ * @param {Object} args - see the usage of the script
+ * @returns {Promise<Array>} one entry per operation, implementation and size
+ */
+const benchmark = async ({ ops, engines, sizes, reps, seed }) => {
+  const results = [];
+  for (const op of ops || Object.keys(operations)) {
+    for (const { engine, funcName } of operations[op].implementations) {
+      if (!engines.includes(engine) || !(engine in runners)) continue;
+      let runner;
+      try {
+        runner = await runners[engine](funcName);
+      } catch (error) {
+        console.error(`Skipping ${engine}:${funcName}, the engine could not be loaded. ${error.message}`);
+        continue;
+      }
+      if (runner === null) continue;
+      for (const n of sizes || sizesOf(op)) {
+        const { data, length } = dataset(op, n, seed),
+          wall = [],
+          kernel = [];
+        let error = null;
+        try {
+          //One warm-up call, then the timed repetitions
+          runner.call(data, length);
+          for (let r = 0; r < reps; r++) {
+            const start = performance.now(),
+              timing = runner.call(data, length);
+            wall.push(performance.now() - start);
+            kernel.push(timing.kernel);
+          }
+        } catch (e) {
+          error = e.message;
+        }
+        const entry = { op, engine, funcName, size: n, instantiate_ms: runner.instantiate };
+        if (error !== null) {
+          results.push({ ...entry, error });
+          continue;
+        }
+        const k = median(kernel),
+          w = median(wall);
+        results.push({
+          ...entry,
+          kernel_ms: k,
+          marshalling_ms: Math.max(0, w - k),
+          wall_ms: w,
+          throughput: data.length / (k / 1000),
+        });
+      }
+    }
+  }
+  return results;
+};
+
+/**
+ * @method table
+ * @memberof engineBench
+ * @description Comparison table of the results, grouped by operation and size.
+ * @param {Array} results - results of benchmark
+ * @returns {String} table
+ */
+const table = (results) => {
+  const fixed = (value, digits = 3) => (typeof value === "number" ? value.toFixed(digits) : "-"),
+    rows = [["operation", "size", "engine", "function", "kernel ms", "marshal ms", "inst ms", "values/s"]];
+  const sorted = [...results].sort(
+    (a, b) => a.op.localeCompare(b.op) || a.size - b.size || (a.kernel_ms || Infinity) - (b.kernel_ms || Infinity)
+  );
+  for (const r of sorted) {
+    rows.push([
+      r.op,
+      String(r.size),
+      r.engine,
+      r.funcName,
+      r.error ? `error: ${r.error}` : fixed(r.kernel_ms),
+      fixed(r.marshalling_ms),
+      fixed(r.instantiate_ms),
+      typeof r.throughput === "number" ? r.throughput.toExponential(2) : "-",
+    ]);
+  }
+  const widths = rows[0].map((_, c) => Math.max(...rows.map((row) => row[c].length)));
+  return rows.map((row) => row.map((cell, c) => cell.padEnd(widths[c])).join("  ")).join("\n");
+};
+
+const args = parseArgs(process.argv);
+const results = await benchmark(args);
+console.log(table(results));
+if (args.json !== null) {
+  const { writeFile } = await import("node:fs/promises");
+  await writeFile(
+    args.json,
+    JSON.stringify({ node: process.versions.node, seed: args.seed, reps: args.reps, results }, null, 2)
+  );
+}
@@ -0,0 +1,177 @@
+/**
+ * @namespace oracles
+ * @description Double precision references of the operations of the cost model. Each oracle evaluates the same
+ * definition as the kernels, with the same parameters and defaults (windows, smoothing factors, iteration limits),
+ * over the float32 inputs given to the engines widened to float64. The difference between an implementation and its
+ * oracle is then the accuracy given up by evaluating it in single precision, and by its order of operations.
+ *
+ * Outputs are Float64Arrays. Values that a kernel leaves undefined (e.g. the first prediction of ARIMA) are NaN and
+ * left out of the comparisons.
+ */
+
+const side = (d) => Math.round(Math.sqrt(d.length / 2));
+
+const mean = (d) => {
+  let sum = 0;
+  for (let i = 0; i < d.length; i++) sum += d[i];
+  return sum / d.length;
+};
+
+/**
+ * @member oracles
+ * @memberof oracles
+ * @description Oracle per operation, taking the input of the operation as a Float64Array.
+ */
+export const oracles = {
+  matrixMultiply: (d) => {
+    const n = side(d),
+      a = d.subarray(0, n * n),
+      b = d.subarray(n * n),
+      c = new Float64Array(n * n);
+    for (let i = 0; i < n; i++) {
+      for (let k = 0; k < n; k++) {
+        const aik = a[i * n + k];
+        for (let j = 0; j < n; j++) c[i * n + j] += aik * b[k * n + j];
+      }
+    }
+    return c;
+  },
+
+  matrixAdd: (d) => {
+    const half = d.length / 2;
+    return Float64Array.from({ length: half }, (_, i) => d[i] + d[half + i]);
+  },
+
+  //Trailing window of 5 values
+  simpleMovingAverage: (d, window = 5) => {
+    const out = new Float64Array(Math.max(0, d.length - window + 1));
+    for (let i = 0; i < out.length; i++) {
+      let sum = 0;
+      for (let j = i; j < i + window; j++) sum += d[j];
+      out[i] = sum / window;
+    }
+    return out;
+  },
+
+  expoMovingAverage: (d, alpha = 0.5) => {
+    const out = new Float64Array(d.length);
+    out[0] = d[0];
+    for (let i = 1; i < d.length; i++) out[i] = alpha * d[i] + (1 - alpha) * out[i - 1];
+    return out;
+  },
+
+  //Weights grow with the distance to the center of a window of 2 values on each side
+  linearWeightedAverage: (d, windowSize = 2) => {
+    const out = new Float64Array(d.length);
+    for (let i = 0; i < d.length; i++) {
+      let sum = 0,
+        weights = 0;
+      for (let j = Math.max(0, i - windowSize); j <= Math.min(d.length - 1, i + windowSize); j++) {
+        sum += d[j] * Math.abs(i - j);
+        weights += Math.abs(i - j);
+      }
+      out[i] = sum / weights;
+    }
+    return out;
+  },
+
+  dspItrend: (d, period = 7) => {
+    const out = new Float64Array(d.length);
+    let avg = 0;
+    for (let i = 0; i < period; i++) avg += d[i];
+    avg /= period;
+    out[0] = avg;
+    for (let i = 1; i < d.length; i++) {
+      avg = (d[i] - avg) * (2 / (period + 1)) + avg;
+      out[i] = avg;
+    }
+    return out;
+  },
+
+  boxcox: (d, lambda = 0.5) => d.map((v) => (lambda === 0 ? Math.log(v) : (v ** lambda - 1) / lambda)),
+
+  //Slope from the covariance over n and the sum of squares of the abscissa, as in linear_detrend
+  linearDetrend: (d) => {
+    const n = d.length;
+    let xMean = 0,
+      yMean = 0,
+      xyCov = 0,
+      xVar = 0;
+    for (let i = 0; i < n; i++) {
+      xMean += i;
+      yMean += d[i];
+      xyCov += i * d[i];
+    }
+    xMean /= n;
+    yMean /= n;
+    xyCov /= n;
+    for (let i = 0; i < n; i++) xVar += (i - xMean) ** 2;
+    const slope = (xyCov - xMean * yMean) / xVar,
+      intercept = yMean - slope * xMean;
+    return d.map((v, i) => v - (slope * i + intercept));
+  },
+
+  acf: (d) => {
+    const n = d.length,
+      m = mean(d),
+      c = d.map((v) => v - m),
+      out = new Float64Array(n);
+    let variance = 0;
+    for (let i = 0; i < n; i++) variance += c[i] * c[i];
+    variance /= n;
+    for (let lag = 0; lag < n; lag++) {
+      let sum = 0;
+      for (let j = lag; j < n; j++) sum += c[j] * c[j - lag];
+      out[lag] = sum / ((n - lag) * variance);
+    }
+    out[0] /= 2;
+    return out;
+  },
+
+  //Same fixed point iteration as arima_autoParams, up to 1000 iterations with a tolerance of 1e-6
+  arima: (d) => {
+    const n = d.length,
+      mu = mean(d),
+      out = new Float64Array(n);
+    let phi = 0.3,
+      theta = -0.2;
+    for (let iteration = 0; iteration < 1000; iteration++) {
+      const [prevPhi, prevTheta] = [phi, theta];
+      let sumXY = 0,
+        sumXSq = 0,
+        sumErrorSq = 0;
+      for (let i = 1; i < n; i++) {
+        const error = d[i] - mu - phi * d[i - 1] - theta * (d[i - 1] - mu);
+        sumXY += d[i - 1] * error;
+        sumXSq += d[i - 1] * d[i - 1];
+        sumErrorSq += error * error;
+      }
+      phi = sumXY / sumXSq;
+      theta = (sumErrorSq - phi * sumXY) / (n - 1);
+      if (Math.hypot(phi - prevPhi, theta - prevTheta) < 1e-6) break;
+    }
+    out[0] = NaN;
+    for (let i = 1; i < n; i++) {
+      const error = d[i] - mu - phi * d[i - 1] - theta * (d[i - 1] - mu);
+      out[i] = mu + phi * d[i - 1] + theta * error;
+    }
+    return out;
+  },
+};
+
+/**
+ * @member layouts
+ * @memberof oracles
+ * @description Layout of the outputs of the implementations that align them differently from the oracles, as a map
+ * from the oracle output to the one expected from the implementation.
+ */
+export const layouts = {
+  //Zeros in place of the values before the first full window
+  simpleMovingAverage: (reference) => {
+    const padded = new Float64Array(reference.length + 4);
+    padded.set(reference, 4);
+    return padded;
+  },
+  //Starts at the second value
+  exponentialMovingAverage: (reference) => reference.subarray(1),
+};
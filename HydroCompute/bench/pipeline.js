@@ -0,0 +1,243 @@
+/**
+ * @namespace pipelineBench
+ * @description Offline, headless version of the statistical dashboard of examples/case-study3, kept as the regression
+ * benchmark of the whole library. The case study retrieves the daily values of the USGS stations of a bounding box
+ * from 1950 to 2023, and runs through the public API:
+ * - independent: _monteCarlo_c, _arima_autoParams and _acf over the series, on a C engine.
+ * - chained: _linear_detrend, _arima_autoParams and _monteCarlo_c, each taking the output of the previous one.
+ * - smoothing: expoMovingAverage_js and simpleMovingAverage_js, on the JavaScript engine.
+ * - results: reading the results of the three runs and removing their non-finite values.
+ *
+ * The station data is synthesized from a seed per station (synthetic.js), or read from a JSON file mapping the site
+ * codes to their daily values, so that no network is needed and every run is fed the same values. Each stage is timed
+ * end to end, from the call to the API to its return, including spawning the workers, loading the modules and
+ * transferring the data.
+ *
+ * Usage:
+ *   node bench/pipeline.js [--engines engine[,engine...]] [--stations n] [--days n] [--data file] [--reps n]
+ *                          [--seed n] [--json file] [--baseline file] [--factor x]
+ *
+ * --engines are the engines of the C stages (wasm, native or auto). With --baseline, the median latency of each stage
+ * and engine is compared with the one saved by a previous --json run, and the script exits with 1 if any grew by more
+ * than --factor.
+ */
+import hydroCompute from "../src/hydrocompute.js";
+import { median } from "./runners.js";
+import { streamflow } from "./synthetic.js";
+
+/**
+ * @description Stages of the case study, with the engine they run on (null for the engine under test).
+ * @memberof pipelineBench
+ */
+const stages = [
+  { name: "independent", engine: null, functions: ["_monteCarlo_c", "_arima_autoParams", "_acf"] },
+  {
+    name: "chained",
+    engine: null,
+    functions: ["_linear_detrend", "_arima_autoParams", "_monteCarlo_c"],
+    dependencies: true,
+  },
+  { name: "smoothing", engine: "javascript", functions: ["expoMovingAverage_js", "simpleMovingAverage_js"] },
+];
+
+//Days between 1950-01-01 and 2023-01-01, the period retrieved by the case study
+const period = 26663;
+
+const parseArgs = (argv) => {
+  const args = {
+    engines: ["wasm", "native"],
+    stations: 3,
+    days: period,
+    data: null,
+    reps: 3,
+    seed: 1,
+    json: null,
+    baseline: null,
+    factor: 1.5,
+  };
+  for (let i = 2; i < argv.length; i += 2) {
+    const [key, value] = [argv[i].replace(/^--/, ""), argv[i + 1]];
+    if (key === "help" || typeof value === "undefined" || !(key in args)) {
+      console.error(
+        "Usage: node bench/pipeline.js [--engines engine,...] [--stations n] [--days n] [--data file] [--reps n] [--seed n] [--json file] [--baseline file] [--factor x]"
+      );
+      process.exit(key === "help" ? 0 : 1);
+    }
+    args[key] = key === "engines" ? value.split(",") : ["data", "json", "baseline"].includes(key) ? value : Number(value);
+  }
+  return args;
+};
+
+/**
+ * @method loadStations
+ * @memberof pipelineBench
+ * @description Daily values per station, from a file or synthesized with a seed per station.
+ * @returns {Promise<Object>} values keyed by site code
+ */
+const loadStations = async ({ data, stations, days, seed }) => {
+  if (data !== null) {
+    const { readFile } = await import("node:fs/promises");
+    return Object.fromEntries(
+      Object.entries(JSON.parse(await readFile(data, "utf8"))).map(([site, values]) => [site, values.map(Number)])
+    );
+  }
+  return Object.fromEntries(
+    Array.from({ length: stations }, (_, i) => [`synthetic-${seed + i}`, Array.from(streamflow(days, seed + i))])
+  );
+};
+
+/**
+ * @method runStation
+ * @memberof pipelineBench
+ * @description Runs the stages of the case study over a station, as a click on its marker does.
+ * @param {hydroCompute} compute - library instance
+ * @param {String} engine - engine of the C stages
+ * @param {String} site - site code
+ * @param {Array} values - daily values
+ * @returns {Promise<Object>} latency of each stage, in ms
+ */
+const runStation = async (compute, engine, site, values) => {
+  const latency = {},
+    simulations = [];
+  await compute.reset();
+  await compute.data({ id: site, data: values });
+  for (const stage of stages) {
+    const start = performance.now();
+    await compute.setEngine(stage.engine || engine);
+    await compute.run({ functions: stage.functions, dependencies: stage.dependencies || [] });
+    latency[stage.name] = performance.now() - start;
+    //Errors of the runs are logged by the library, which then leaves no results
+    if (typeof compute.engineResults[`Simulation_${compute.instanceRun}`] === "undefined") {
+      throw new Error(`the ${stage.name} stage did not return results`);
+    }
+    simulations.push(`Simulation_${compute.instanceRun}`);
+  }
+  const start = performance.now();
+  for (const name of simulations) {
+    const [result] = compute.results(name);
+    result.results.map((values) => compute.utils.cleanArray(values));
+  }
+  latency.results = performance.now() - start;
+  latency.total = Object.values(latency).reduce((a, b) => a + b, 0);
+  return latency;
+};
+
+/**
+ * @method benchmark
+ * @memberof pipelineBench
+ * @description Runs the case study over every station with each engine.
+ * @param {Object} args - see the usage of the script
+ * @returns {Promise<Array>} one entry per engine and stage, with the latencies over the stations and repetitions
+ */
+const benchmark = async (args) => {
+  const stations = await loadStations(args),
+    stageNames = [...stages.map((s) => s.name), "results", "total"],
+    results = [],
+    log = console.log;
+  for (const engine of args.engines) {
+    const samples = Object.fromEntries(stageNames.map((name) => [name, []]));
+    let error = null;
+    //Library logs are left out of the report
+    console.log = () => {};
+    try {
+      const compute = new hydroCompute("javascript");
+      for (let r = 0; r <= args.reps; r++) {
+        for (const [site, values] of Object.entries(stations)) {
+          const latency = await runStation(compute, engine, site, values);
+          //The first pass over the stations warms up the workers and modules, and is reported apart
+          for (const name of stageNames) samples[name].push({ latency: latency[name], cold: r === 0 });
+        }
+      }
+    } catch (e) {
+      error = e.message;
+    } finally {
+      console.log = log;
+    }
+    if (error !== null) {
+      console.error(`Skipping the ${engine} engine: ${error}.`);
+      continue;
+    }
+    for (const name of stageNames) {
+      const warm = samples[name].filter((s) => !s.cold).map((s) => s.latency),
+        cold = samples[name].filter((s) => s.cold).map((s) => s.latency);
+      results.push({
+        engine,
+        stage: name,
+        runs: warm.length,
+        cold_ms: cold[0],
+        median_ms: median(warm),
+        min_ms: Math.min(...warm),
+        max_ms: Math.max(...warm),
+      });
+    }
+  }
+  return results;
+};
+
+/**
+ * @method check
+ * @memberof pipelineBench
+ * @description Compares the median latencies with those of a previous run.
+ * @returns {Array} the stages that slowed down by more than the factor
+ */
+const check = (results, baseline, factor) => {
+  const previous = new Map((baseline || []).map((r) => [`${r.engine}/${r.stage}`, r])),
+    regressions = [];
+  for (const r of results) {
+    const before = previous.get(`${r.engine}/${r.stage}`);
+    if (typeof before !== "undefined" && r.median_ms > before.median_ms * factor) {
+      r.regression = before.median_ms;
+      regressions.push(r);
+    }
+  }
+  return regressions;
+};
+
+const args = parseArgs(process.argv);
+const results = await benchmark(args);
+let baseline = null;
+if (args.baseline !== null) {
+  const { readFile } = await import("node:fs/promises");
+  baseline = JSON.parse(await readFile(args.baseline, "utf8")).results;
+}
+const regressions = check(results, baseline, args.factor);
+
+const fixed = (v) => (typeof v === "number" ? v.toFixed(1) : "-"),
+  rows = [["engine", "stage", "runs", "cold ms", "median ms", "min ms", "max ms", ""]];
+for (const r of results) {
+  rows.push([
+    r.engine,
+    r.stage,
+    String(r.runs),
+    fixed(r.cold_ms),
+    fixed(r.median_ms),
+    fixed(r.min_ms),
+    fixed(r.max_ms),
+    typeof r.regression === "number" ? `REGRESSION from ${fixed(r.regression)}` : "",
+  ]);
+}
+const widths = rows[0].map((_, c) => Math.max(...rows.map((row) => row[c].length)));
+console.log(rows.map((row) => row.map((cell, c) => cell.padEnd(widths[c])).join("  ").trimEnd()).join("\n"));
+
+if (args.json !== null) {
+  const { writeFile } = await import("node:fs/promises");
+  await writeFile(
+    args.json,
+    JSON.stringify(
+      {
+        node: process.versions.node,
+        seed: args.seed,
+        stations: args.data !== null ? args.data : args.stations,
+        days: args.days,
+        reps: args.reps,
+        results,
+      },
+      null,
+      2
+    )
+  );
+}
+if (regressions.length > 0) {
+  console.error(`${regressions.length} stage(s) slowed down against ${args.baseline}.`);
+  process.exit(1);
+}
@@ -0,0 +1,199 @@
+/**
+ * @namespace profileBench
+ * @description Sampling profiler of the C kernels compiled to Web Assembly. A kernel is called repeatedly in the main
+ * thread of Node.js, through the same path as in the engine workers, while the CPU profiler of V8 samples the stacks
+ * through the inspector. The frames of the module are named after the C functions:
+ * - profiling builds (./build.sh profiling) keep the names of the functions in the binary, e.g.
+ *   run_monte_carlo_simulation and generate_random_variates, which V8 reports directly.
+ * - other builds are named from their symbol map (<module>.js.symbols), or else from their exports, leaving the
+ *   internal functions as wasm-function[index].
+ *
+ * The stacks are written as folded stacks, one line per stack with its sample count, as read by flamegraph.pl,
+ * inferno and speedscope. The profile of V8 can also be saved, with the renamed frames, to be opened in the
+ * performance panel of Chrome DevTools.
+ *
+ * Usage:
+ *   node bench/profile.js [--function name] [--size n] [--duration ms] [--interval us] [--seed n] [--output file]
+ *                         [--cpuprofile file] [--frames all|wasm]
+ *
+ * Sizes are values per series, or elements per matrix. --frames wasm trims the stacks to the calls into the module.
+ */
+import { Session } from "node:inspector/promises";
+import { readFile, writeFile } from "node:fs/promises";
+import { findOperation } from "../src/core/utils/costModel.js";
+import { splits } from "../src/core/utils/splits.js";
+import { CModule } from "../src/wasm/modules/modules.js";
+import { availableBuilds } from "../src/wasm/modules/standalone.js";
+import { CUtils } from "../src/wasm/modules/C/mods.js";
+import { dataset } from "./synthetic.js";
+
+globalThis.self = globalThis.self || globalThis;
+const { handleC } = await import("../src/wasm/wasm.worker.js");
+
+const parseArgs = (argv) => {
+  const args = {
+    function: "_monteCarlo_c",
+    size: 100000,
+    duration: 2000,
+    interval: 100,
+    seed: 1,
+    output: null,
+    cpuprofile: null,
+    frames: "all",
+  };
+  for (let i = 2; i < argv.length; i += 2) {
+    const [key, value] = [argv[i].replace(/^--/, ""), argv[i + 1]];
+    if (key === "help" || typeof value === "undefined" || !(key in args)) {
+      console.error(
+        "Usage: node bench/profile.js [--function name] [--size n] [--duration ms] [--interval us] [--seed n] [--output file] [--cpuprofile file] [--frames all|wasm]"
+      );
+      process.exit(key === "help" ? 0 : 1);
+    }
+    args[key] = ["size", "duration", "interval", "seed"].includes(key) ? Number(value) : value;
+  }
+  return args;
+};
+
+/**
+ * @method loadKernel
+ * @memberof profileBench
+ * @description Loads the module exporting a C kernel, preferring its profiling build.
+ * @param {String} funcName - kernel name, e.g. _monteCarlo_c
+ * @returns {Promise<Object>} module name, module and whether it is the profiling build
+ */
+const loadKernel = async (funcName) => {
+  const builds = await availableBuilds();
+  for (const name of Object.keys(CUtils)) {
+    const profiling = (builds[name] || []).includes("profiling"),
+      module = await CModule(name, { profiling });
+    if (module && typeof module[funcName] === "function") return { name, module, profiling };
+  }
+  throw new Error(`No C module exports ${funcName}.`);
+};
+
+/**
+ * @method symbolNames
+ * @memberof profileBench
+ * @description Names of the functions of a module by function index, from its symbol map, or else from the exports
+ * called so far.
+ * @returns {Promise<Map>} names by index
+ */
+const symbolNames = async ({ name, module, profiling }) => {
+  const names = new Map();
+  try {
+    const map = await readFile(
+      new URL(`../src/wasm/modules/C/${name}/${name}${profiling ? ".prof" : ""}.js.symbols`, import.meta.url),
+      "utf8"
+    );
+    for (const line of map.split("\n")) {
+      const [index, symbol] = line.split(":");
+      typeof symbol !== "undefined" ? names.set(Number(index), symbol.trim()) : null;
+    }
+    return names;
+  } catch {
+    //Builds without a symbol map
+  }
+  //Exported Web Assembly functions are named after their index. The glue binds them lazily, on their first call
+  for (const [key, value] of Object.entries({ ...(module.asm || {}), ...module })) {
+    key.startsWith("_") && typeof value === "function" && /^\d+$/.test(value.name)
+      ? names.set(Number(value.name), key.slice(1))
+      : null;
+  }
+  return names;
+};
+
+/**
+ * @method frameName
+ * @memberof profileBench
+ * @description Name of a frame of the profile, resolving the unnamed Web Assembly functions.
+ */
+const frameName = ({ functionName, url }, names) => {
+  const index = functionName.match(/^(?:wasm-function\[(\d+)\]|\$func(\d+))$/);
+  if (index !== null) {
+    const i = Number(index[1] || index[2]);
+    return names.get(i) || functionName;
+  }
+  if (functionName === "") return url === "" ? "(anonymous)" : `(anonymous ${url.split("/").pop()})`;
+  return functionName.replace(/^\$/, "");
+};
+
+/**
+ * @method fold
+ * @memberof profileBench
+ * @description Folded stacks of a CPU profile: the frames from the root to each sampled node, with its samples.
+ * @param {Object} profile - profile returned by Profiler.stop
+ * @param {Map} names - names of the module functions by index
+ * @param {String} frames - all, or wasm to start the stacks at the call into the module
+ * @returns {Map} sample counts by folded stack
+ */
+const fold = (profile, names, frames) => {
+  const nodes = new Map(profile.nodes.map((node) => [node.id, node])),
+    parents = new Map(),
+    stacks = new Map();
+  for (const node of profile.nodes) for (const child of node.children || []) parents.set(child, node.id);
+  for (const node of profile.nodes) {
+    if (!node.hitCount) continue;
+    const stack = [];
+    for (let id = node.id; typeof id !== "undefined"; id = parents.get(id)) {
+      const callFrame = nodes.get(id).callFrame;
+      if (callFrame.functionName === "(root)") break;
+      stack.unshift({ name: frameName(callFrame, names), wasm: callFrame.url.startsWith("wasm://") });
+    }
+    const start = frames === "wasm" ? stack.findIndex((f) => f.wasm) : 0;
+    if (start < 0) continue;
+    const key = stack
+      .slice(start)
+      .map((f) => f.name.replace(/;/g, ":"))
+      .join(";");
+    stacks.set(key, (stacks.get(key) || 0) + node.hitCount);
+  }
+  return stacks;
+};
+
+const args = parseArgs(process.argv);
+const kernel = await loadKernel(args.function),
+  op = findOperation(args.function) || "series",
+  { data, length } = dataset(op, args.size, args.seed),
+  call = () => handleC(kernel.name, args.function, splits.split1DArray({ data, n: length }), kernel.module);
+
+//One call outside of the profile compiles the module, sizes its heap and binds the exports
+call();
+const names = await symbolNames(kernel);
+const session = new Session();
+session.connect();
+await session.post("Profiler.enable");
+await session.post("Profiler.setSamplingInterval", { interval: args.interval });
+await session.post("Profiler.start");
+let calls = 0;
+const start = performance.now();
+while (performance.now() - start < args.duration) {
+  call();
+  calls += 1;
+}
+const { profile } = await session.post("Profiler.stop");
+session.disconnect();
+performance.clearMarks();
+
+const stacks = fold(profile, names, args.frames),
+  folded = [...stacks].map(([stack, count]) => `${stack} ${count}`).join("\n") + "\n";
+args.output !== null ? await writeFile(args.output, folded) : process.stdout.write(folded);
+if (args.cpuprofile !== null) {
+  for (const node of profile.nodes) node.callFrame.functionName = frameName(node.callFrame, names);
+  await writeFile(args.cpuprofile, JSON.stringify(profile));
+}
+
+//Self samples of the heaviest frames
+const self = new Map();
+let total = 0;
+for (const [stack, count] of stacks) {
+  const leaf = stack.slice(stack.lastIndexOf(";") + 1);
+  self.set(leaf, (self.get(leaf) || 0) + count);
+  total += count;
+}
+console.error(
+  `${args.function} from the ${kernel.profiling ? "profiling" : "default"} build of ${kernel.name}: ${calls} calls, ` +
+    `${total} samples${kernel.profiling ? "" : ". Build it with ./build.sh profiling to name its internal functions"}.`
+);
+for (const [leaf, count] of [...self].sort((a, b) => b[1] - a[1]).slice(0, 10)) {
+  console.error(`  ${((100 * count) / total).toFixed(1).padStart(5)}%  ${leaf}`);
+}
@@ -0,0 +1,106 @@
+/**
+ * @namespace benchRunners
+ * @description Runners shared by the benchmarks. Each engine loads what an implementation needs once in the main
+ * thread of Node.js, and every call goes through the same path as in the engine workers.
+ */
+import { splits } from "../src/core/utils/splits.js";
+import { ASModule, CModule } from "../src/wasm/modules/modules.js";
+import { CUtils } from "../src/wasm/modules/C/mods.js";
+import { ASUtils } from "../src/wasm/modules/assemblyScript/mods.js";
+
+//The wasm worker registers its handler on the worker scope when loaded
+globalThis.self = globalThis.self || globalThis;
+const { handleAS, handleC } = await import("../src/wasm/wasm.worker.js");
+
+/**
+ * @description Median of an array of numbers.
+ * @memberof benchRunners
+ */
+export const median = (values) => {
+  const sorted = [...values].sort((a, b) => a - b),
+    mid = sorted.length >> 1;
+  return sorted.length % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+};
+
+/**
+ * @description Kernel time of the last call, from the marks left by the worker handlers.
+ * @memberof benchRunners
+ */
+export const kernelTime = () => {
+  const duration = performance.measure("bench-kernel", "start-function", "end-function").duration;
+  performance.clearMarks();
+  performance.clearMeasures();
+  return duration;
+};
+
+/**
+ * @description Times the instantiation of a module, returning the module and the time in ms.
+ * @memberof benchRunners
+ */
+export const instantiate = async (load) => {
+  const start = performance.now(),
+    module = await load();
+  return { module, time: performance.now() - start };
+};
+
+/**
+ * @description Runners of the engines. Each loads what an implementation needs once, then returns a call that takes
+ * the engine data and returns { output, kernel } with the kernel time in ms.
+ * @memberof benchRunners
+ */
+export const runners = {
+  javascript: async (funcName) => {
+    const { time, module: scripts } = await instantiate(() => import("../src/javascript/scripts/scripts.js")),
+      script = Object.values(scripts).find((s) => typeof s[funcName] === "function");
+    if (typeof script === "undefined") return null;
+    //Same conversions as the JavaScript worker
+    return {
+      instantiate: time,
+      call: (data) => {
+        const input = [...data];
+        performance.mark("start-function");
+        const output = script.main(funcName, input);
+        performance.mark("end-function");
+        return { output: new Float32Array(output), kernel: kernelTime() };
+      },
+    };
+  },
+
+  wasm: async (funcName) => {
+    const isC = funcName.startsWith("_"),
+      names = Object.keys(isC ? CUtils : ASUtils);
+    for (const name of names) {
+      const { module, time } = await instantiate(() => (isC ? CModule(name) : ASModule(name)));
+      if (module && funcName in module) {
+        return {
+          instantiate: time,
+          call: (data, length) => {
+            const chunks = splits.split1DArray({ data, n: length }),
+              output = isC
+                ? handleC(name, funcName, chunks, module)
+                : handleAS(name, module[funcName], chunks, module, []);
+            return { output: new Float32Array(output), kernel: kernelTime() };
+          },
+        };
+      }
+    }
+    return null;
+  },
+
+  native: async (funcName) => {
+    let addon;
+    const { time } = await instantiate(async () => {
+      const { loadAddon } = await import("../src/native/nativeThread.js");
+      addon = loadAddon();
+    });
+    const kernel = funcName.replace(/^_/, "");
+    if (!addon.kernels().includes(kernel)) return null;
+    return {
+      instantiate: time,
+      call: (data) => {
+        const output = addon.runSync(kernel, data);
+        return { output, kernel: output.elapsed };
+      },
+    };
+  },
+};
@@ -0,0 +1,207 @@
+/**
+ * @namespace scalingBench
+ * @description Strong and weak scaling of the thread manager. Representative workloads run through an engine with
+ * 1 to N workers, and the time of each run is broken down with the timeline kept by the thread manager for every
+ * task (see taskPhases in globalUtils):
+ * - spawn, instantiate, transferIn, kernel and transferOut, summed over the tasks of the run.
+ * - scheduling: the part of the wall time where no task was in flight, i.e. splitting and copying the data, the DAG
+ *   and batches, memory admission and reassembly of the results.
+ *
+ * Workloads:
+ * - elementwise: a series split across the workers and transformed (Box-Cox), then reassembled.
+ * - arima: independent ARIMA fits over the same series.
+ * - montecarlo: Monte Carlo shards over a split series.
+ * - gemm: independent products of the same pair of matrices.
+ *
+ * In strong scaling the problem is fixed, with the size or the task count of the largest worker count. In weak
+ * scaling it grows with the workers, so that each worker keeps the same share.
+ *
+ * Usage:
+ *   node bench/scaling.js [--engine wasm|native] [--workers n[,n...]] [--workloads name[,name...]]
+ *                         [--modes strong,weak] [--reps n] [--seed n] [--json file]
+ */
+import engine from "../src/core/mainEngine.js";
+import { kernels } from "../src/core/kernels.js";
+import { taskPhases } from "../src/core/utils/globalUtils.js";
+import { hardwareConcurrency } from "../src/core/utils/runtime.js";
+import { streamflow, matrixPair } from "./synthetic.js";
+
+/**
+ * @description Workloads, given as the tasks of a run for a share (number of workers sharing the problem).
+ * @memberof scalingBench
+ */
+const workloads = {
+  elementwise: (share, seed) => ({
+    funcName: "_boxcox_transform",
+    tasks: share,
+    isSplit: true,
+    data: streamflow(share * (1 << 20), seed),
+    length: 1,
+  }),
+  arima: (share, seed) => ({
+    funcName: "_arima_autoParams",
+    tasks: share,
+    isSplit: false,
+    data: streamflow(100000, seed),
+    length: 1,
+  }),
+  montecarlo: (share, seed) => ({
+    funcName: "_monteCarlo_c",
+    tasks: share,
+    isSplit: true,
+    data: streamflow(share * 365 * 16, seed),
+    length: 1,
+  }),
+  gemm: (share, seed) => ({
+    funcName: "_matrixMultiply_c",
+    tasks: share,
+    isSplit: false,
+    data: matrixPair(256, seed),
+    length: 2,
+  }),
+};
+
+const phaseNames = ["spawn", "instantiate", "transferIn", "kernel", "transferOut"];
+
+const parseArgs = (argv) => {
+  const max = Math.max(1, hardwareConcurrency() - 1),
+    workers = [];
+  for (let w = 1; w < max; w *= 2) workers.push(w);
+  workers.push(max);
+  const args = {
+    engine: "wasm",
+    workers,
+    workloads: Object.keys(workloads),
+    modes: ["strong", "weak"],
+    reps: 3,
+    seed: 1,
+    json: null,
+  };
+  for (let i = 2; i < argv.length; i += 2) {
+    const [key, value] = [argv[i].replace(/^--/, ""), argv[i + 1]];
+    if (key === "help" || typeof value === "undefined" || !(key in args)) {
+      console.error(
+        "Usage: node bench/scaling.js [--engine wasm|native] [--workers n,...] [--workloads name,...] [--modes strong,weak] [--reps n] [--seed n] [--json file]"
+      );
+      process.exit(key === "help" ? 0 : 1);
+    }
+    args[key] =
+      key === "workers"
+        ? value.split(",").map(Number)
+        : ["workloads", "modes"].includes(key)
+        ? value.split(",")
+        : ["reps", "seed"].includes(key)
+        ? Number(value)
+        : value;
+  }
+  return args;
+};
+
+/**
+ * @description Length of the union of the intervals during which tasks were in flight.
+ * @memberof scalingBench
+ */
+const busyTime = (timings) => {
+  const intervals = timings.map((t) => [t.spawned, t.received]).sort((a, b) => a[0] - b[0]);
+  let busy = 0,
+    [start, end] = intervals.length > 0 ? intervals[0] : [0, 0];
+  for (const [s, e] of intervals) {
+    if (s > end) {
+      busy += end - start;
+      start = s;
+    }
+    end = Math.max(end, e);
+  }
+  return busy + (end - start);
+};
+
+/**
+ * @method measure
+ * @memberof scalingBench
+ * @description Runs a workload once on an engine limited to a number of workers.
+ * @returns {Promise<Object>} wall time and breakdown of the run, in ms
+ */
+const measure = async (eng, workers, { funcName, tasks, isSplit, data, length }) => {
+  eng.threads.setWorkerLimit(workers);
+  const start = performance.now();
+  await eng.run({
+    data: [data],
+    length: [length],
+    functions: [Array(tasks).fill(funcName)],
+    funcArgs: [],
+    dependencies: [],
+    isSplit: [isSplit],
+    scriptName: [[]],
+  });
+  const wall = performance.now() - start,
+    { timings = [] } = eng.results.pop(),
+    breakdown = Object.fromEntries(phaseNames.map((p) => [p, 0]));
+  for (const timing of timings) {
+    const phases = taskPhases(timing);
+    for (const p of phaseNames) breakdown[p] += phases[p];
+  }
+  breakdown.scheduling = Math.max(0, wall - busyTime(timings));
+  return { wall, tasks: timings.length, breakdown };
+};
+
+const args = parseArgs(process.argv);
+const eng = new engine(args.engine, kernels[args.engine]),
+  largest = Math.max(...args.workers),
+  results = [],
+  log = console.log;
+
+for (const name of args.workloads) {
+  for (const mode of args.modes) {
+    let base = null;
+    for (const workers of args.workers) {
+      const share = mode === "strong" ? largest : workers,
+        runs = [];
+      //Engine and worker logs are left out of the report
+      console.log = () => {};
+      try {
+        //Inputs are transferred into the workers, each run gets its own
+        await measure(eng, workers, workloads[name](share, args.seed));
+        for (let r = 0; r < args.reps; r++) {
+          runs.push(await measure(eng, workers, workloads[name](share, args.seed)));
+        }
+      } catch (error) {
+        console.log = log;
+        console.error(`${name} could not run on the ${args.engine} engine with ${workers} workers.`, error.message);
+        process.exit(1);
+      } finally {
+        console.log = log;
+      }
+      const run = runs.sort((a, b) => a.wall - b.wall)[runs.length >> 1];
+      base = base === null ? run.wall : base;
+      //Strong scaling is measured by the speedup, weak scaling by keeping the time flat
+      const speedup = mode === "strong" ? base / run.wall : (base * workers) / run.wall;
+      results.push({ workload: name, mode, workers, ...run, speedup, efficiency: speedup / workers });
+    }
+  }
+}
+
+const fixed = (v) => v.toFixed(1),
+  rows = [["workload", "mode", "workers", "tasks", "wall ms", "speedup", "eff", ...phaseNames, "scheduling"]];
+for (const r of results) {
+  rows.push([
+    r.workload,
+    r.mode,
+    String(r.workers),
+    String(r.tasks),
+    fixed(r.wall),
+    r.speedup.toFixed(2),
+    r.efficiency.toFixed(2),
+    ...[...phaseNames, "scheduling"].map((p) => fixed(r.breakdown[p])),
+  ]);
+}
+const widths = rows[0].map((_, c) => Math.max(...rows.map((row) => row[c].length)));
+console.log(rows.map((row) => row.map((cell, c) => cell.padEnd(widths[c])).join("  ")).join("\n"));
+console.log("\nPhases are summed over the tasks of a run, scheduling is the wall time with no task in flight.");
+
+if (args.json !== null) {
+  const { writeFile } = await import("node:fs/promises");
+  await writeFile(
+    args.json,
+    JSON.stringify({ engine: args.engine, node: process.versions.node, seed: args.seed, results }, null, 2)
+  );
+}
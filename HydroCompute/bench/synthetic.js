@@ -0,0 +1,109 @@
+/**
+ * @namespace synthetic
+ * @description Seeded synthetic datasets for the benchmarks. Every engine is fed the same values for a given seed and
+ * size, so timings and outputs can be compared across engines, machines and versions.
+ */
+
+/**
+ * @method random
+ * @memberof synthetic
+ * @description Small, fast seeded generator (mulberry32) of uniform values in [0, 1).
+ * @param {Number} seed - 32 bit seed
+ * @returns {Function} generator
+ */
+export const random = (seed) => {
+  let state = seed >>> 0;
+  return () => {
+    state = (state + 0x6d2b79f5) >>> 0;
+    let t = state;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+};
+
+/**
+ * @method streamflow
+ * @memberof synthetic
+ * @description Daily discharge: a seasonal cycle, storm peaks with an exponential recession and noise. Values are
+ * strictly positive, as needed by transforms such as Box-Cox.
+ * @param {Number} n - number of days
+ * @param {Number} [seed=1] - seed of the series
+ * @returns {Float32Array} discharge
+ */
+export const streamflow = (n, seed = 1) => {
+  const next = random(seed),
+    values = new Float32Array(n);
+  let storm = 0;
+  for (let i = 0; i < n; i++) {
+    storm = next() < 0.02 ? storm + 40 * next() : storm * 0.8;
+    values[i] = 20 + 8 * Math.sin((2 * Math.PI * (i % 365)) / 365) + 2 * next() + storm;
+  }
+  return values;
+};
+
+/**
+ * @method matrixPair
+ * @memberof synthetic
+ * @description Two square matrices stored one after the other, row major, as taken by the matrix kernels.
+ * @param {Number} side - side of the matrices
+ * @param {Number} [seed=1] - seed of the values
+ * @returns {Float32Array} both matrices
+ */
+export const matrixPair = (side, seed = 1) => {
+  const next = random(seed);
+  return Float32Array.from({ length: 2 * side * side }, () => next() - 0.5);
+};
+
+/**
+ * @method dataset
+ * @memberof synthetic
+ * @description Input of an operation of the cost model, in the layout of the engine data.
+ * @param {String} op - operation name, see costModel.operations
+ * @param {Number} n - values per input, or elements per matrix for matrix operations
+ * @param {Number} [seed=1] - seed of the values
+ * @returns {Object} { data, length }, length being the number of inputs stored in data
+ */
+export const dataset = (op, n, seed = 1) =>
+  op.startsWith("matrix")
+    ? { data: matrixPair(Math.max(1, Math.floor(Math.sqrt(n))), seed), length: 2 }
+    : { data: streamflow(n, seed), length: 1 };
+
+/**
+ * @method offsetSeries
+ * @memberof synthetic
+ * @description Ill-conditioned series: small fluctuations over a large mean, e.g. stage readings against a gauge
+ * datum. Means, variances and trends computed in single precision lose most of their digits to cancellation.
+ * @param {Number} n - number of values
+ * @param {Number} [seed=1] - seed of the series
+ * @returns {Float32Array} values
+ */
+export const offsetSeries = (n, seed = 1) => streamflow(n, seed).map((v) => 10000 + v / 100);
+
+/**
+ * @method wideRange
+ * @memberof synthetic
+ * @description Strictly positive series spanning about eight orders of magnitude, as sediment loads or concentrations
+ * do, where sums are dominated by the largest values.
+ * @param {Number} n - number of values
+ * @param {Number} [seed=1] - seed of the series
+ * @returns {Float32Array} values
+ */
+export const wideRange = (n, seed = 1) => {
+  const next = random(seed);
+  return Float32Array.from({ length: n }, () => Math.exp(-7 + 18 * next()));
+};
+
+/**
+ * @method scaledMatrixPair
+ * @memberof synthetic
+ * @description Two square matrices with entries scaled by powers of ten between 1e-4 and 1e4 and random signs, so
+ * that the dot products of the matrix product cancel.
+ * @param {Number} side - side of the matrices
+ * @param {Number} [seed=1] - seed of the values
+ * @returns {Float32Array} both matrices
+ */
+export const scaledMatrixPair = (side, seed = 1) => {
+  const next = random(seed);
+  return Float32Array.from({ length: 2 * side * side }, () => (next() - 0.5) * 10 ** Math.round(8 * next() - 4));
+};
@@ -0,0 +1,237 @@
+import engine from "./mainEngine.js";
+import { kernels } from "./kernels.js";
+import { CostModel, findOperation } from "./utils/costModel.js";
+import { ValueErr } from "./utils/errors.js";
+import { hardwareConcurrency } from "./utils/runtime.js";
+
+/**
+ * @class
+ * @name autoEngine
+ * @description Engine that routes each step of a run to the fastest measured implementation among the available
+ * engines, following a calibrated cost model. Steps whose functions are chained run entirely on the single engine
+ * with the lowest predicted total; single chunkable functions are split across workers when the model predicts a gain.
+ * @property results - array with results, in the same layout as the engine class
+ * @property engines - engine instances created on demand for each backend
+ * @property costModel - measured cost model used for the routing
+ * @property plan - routing decisions taken for the last run
+ * @param {CostModel} [costModel] - calibrated model. A model stored in the browser is used if none is given.
+ * @param {Array} [engines] - backends eligible for routing. Defaults to the javascript and wasm engines.
+ */
+export default class autoEngine {
+  constructor(costModel, engines = ["javascript", "wasm"]) {
+    this.engineName = "auto";
+    this.eligible = engines;
+    this.engines = {};
+    this.memo = null;
+    this.tracer = null;
+    this.metrics = null;
+    this.costModel = costModel || CostModel.load() || new CostModel();
+    this.setEngine();
+  }
+
+  /**
+   * @method backend
+   * @memberof autoEngine
+   * @description Returns the engine instance for a backend, creating it the first time it is needed.
+   * @param {String} name - backend name
+   * @returns {engine} engine instance
+   */
+  backend(name) {
+    if (typeof this.engines[name] === "undefined") {
+      this.engines[name] = new engine(name, kernels[name]);
+    }
+    this.engines[name].memo = this.memo;
+    this.engines[name].tracer = this.tracer;
+    this.engines[name].metrics = this.metrics;
+    return this.engines[name];
+  }
+
+  /**
+   * @method calibrate
+   * @memberof autoEngine
+   * @description Runs the calibration pass of the cost model through the eligible engines.
+   * @param {Object} [args] - calibration arguments, see CostModel.calibrate
+   * @returns {Promise<CostModel>} calibrated model
+   */
+  async calibrate(args = {}) {
+    const runner = async (name, funcName, { data, length }) => {
+      const eng = this.backend(name);
+      //Timings must come from actual runs, not from the memo
+      eng.memo = null;
+      const start = performance.now();
+      await eng.run({
+        data: [data],
+        length: [length],
+        functions: [[funcName]],
+        funcArgs: [],
+        dependencies: [],
+        isSplit: [false],
+        scriptName: [[]],
+      });
+      const wall = performance.now() - start,
+        { funcEx, results } = eng.results.pop();
+      return { funcEx, wall, output: new Float32Array(results[0]) };
+    };
+    await this.costModel.calibrate({ engines: this.eligible, ...args, runner });
+    this.costModel.save();
+    return this.costModel;
+  }
+
+  /**
+   * @method route
+   * @memberof autoEngine
+   * @description Chooses the engine, function names and split for a step.
+   * @param {Array} functions - functions of the step
+   * @param {Number} n - number of elements of the step data
+   * @param {Boolean} chained - whether the functions depend on each other
+   * @returns {Object} { engine, functions, split }
+   */
+  route(functions, n, chained) {
+    const maxWorkers = Math.max(1, hardwareConcurrency() - 1);
+    if (functions.length === 1 && !chained) {
+      const choice = this.costModel.select(functions[0], n, {
+        engines: this.eligible,
+        maxWorkers,
+      });
+      if (choice === null) {
+        throw new ValueErr(`No measured implementation found for ${functions[0]}.`);
+      }
+      return {
+        engine: choice.engine,
+        functions: Array(choice.workers).fill(choice.funcName),
+        split: choice.workers > 1,
+      };
+    }
+    //Several functions in a step stay together on the engine with the lowest predicted total
+    let best = null;
+    for (let name of this.eligible) {
+      let total = 0,
+        names = [];
+      for (let fn of functions) {
+        const choice = this.costModel.select(fn, n, { engines: [name] });
+        if (choice === null) {
+          total = Infinity;
+          break;
+        }
+        total += choice.predicted;
+        names.push(choice.funcName);
+      }
+      if (total < Infinity && (best === null || total < best.total)) {
+        best = { engine: name, functions: names, split: false, total };
+      }
+    }
+    if (best === null) {
+      throw new ValueErr(
+        `No single engine implements all of: ${functions.join(", ")}.`
+      );
+    }
+    return best;
+  }
+
+  /**
+   * @method run
+   * @memberof autoEngine
+   * @description Routes every step of the run and executes it on the selected engine.
+   * @param {Object} args - run arguments, as received by the engine class
+   * @returns {Promise<Boolean>} true once all the steps have finished
+   */
+  async run(args) {
+    const {
+      functions = [],
+      funcArgs = [],
+      dependencies = [],
+      data = [],
+      length = [],
+      scriptName = [],
+      sessions = [],
+      ...rest
+    } = args;
+    if (scriptName.some((names) => names && names.length > 0)) {
+      throw new ValueErr("Scripts passed by name cannot be routed automatically.");
+    }
+    for (let fn of functions.flat()) {
+      if (findOperation(fn) === null) {
+        throw new ValueErr(`Function ${fn} is not registered in the cost model.`);
+      }
+    }
+    this.plan = [];
+    //Linked steps trail their results down, so the whole chain runs on a single engine
+    if (rest.linked) {
+      const route = this.route(functions.flat(), data[0].length, true),
+        eng = this.backend(route.engine);
+      let k = 0;
+      const names = functions.map((fns) => fns.map(() => route.functions[k++]));
+      this.plan.push({ step: "linked", ...route });
+      await eng.run({ ...args, functions: names });
+      this.results.push(...eng.results);
+      eng.results = [];
+      return true;
+    }
+    for (let i = 0; i < functions.length; i++) {
+      const deps = dependencies[i] || [],
+        chained = deps.some((dep) => dep.length > 0),
+        route = this.route(functions[i], data[i].length, chained);
+      this.plan.push({ step: i, ...route });
+      const eng = this.backend(route.engine);
+      await eng.run({
+        ...rest,
+        data: [data[i]],
+        length: [length[i]],
+        functions: [route.functions],
+        //Split chunks reuse the arguments of the original call
+        funcArgs: [
+          route.split
+            ? route.functions.map(() => funcArgs[i] && funcArgs[i][0])
+            : funcArgs[i],
+        ],
+        dependencies: [deps],
+        isSplit: [route.split],
+        scriptName: [[]],
+        sessions: [sessions[i]],
+      });
+      this.results.push(...eng.results);
+      eng.results = [];
+    }
+    return true;
+  }
+
+  /**
+   * @method append
+   * @memberof autoEngine
+   * @description Routes appended values to the backend that keeps the incremental state of the series.
+   * @param {Object} args - append arguments, see the append method of the engine class
+   * @returns {Boolean} true if a backend had an incremental state for the series
+   */
+  append(args) {
+    for (let eng of Object.values(this.engines)) {
+      if (eng.append(args)) {
+        this.results.push(...eng.results);
+        eng.results = [];
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @description resets the results of the engine
+   * @memberof autoEngine
+   * @method setEngine
+   */
+  setEngine() {
+    this.results = [];
+    this.plan = [];
+  }
+
+  /**
+   * @method availableScripts
+   * @memberof autoEngine
+   * @description Returns the operations that can be routed along with their measured implementations
+   * @returns {Map} operations and implementation ids
+   */
+  availableScripts() {
+    return new Map(
+      Object.entries(this.costModel.points).map(([op, impls]) => [op, Object.keys(impls)])
+    );
+  }
+}
@@ -7,4 +7,5 @@ export const kernels = {
     wasm: "../../src/wasm/wasm.worker.js",
     javascript: "../../src/javascript/js.worker.js",
     webgpu: "../../src/webgpu/wgpu.worker.js",
+    native: "../../src/native/nativeThread.js",
 }
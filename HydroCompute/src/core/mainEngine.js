@@ -1,9 +1,22 @@
-import { DAG } from "./utils/globalUtils.js";
+import { DAG, concatArrays, wallClock } from "./utils/globalUtils.js";
 import threadManager from "./threadEngine.js";
-import { splits } from "./utils/splits.js";
-import { jsScripts } from "../javascript/jsScripts.js";
-import { avScripts } from "../wasm/modules/modules.js";
-import { gpuScripts } from "../webgpu/gpuScripts.js";
+import { splits, halos } from "./utils/splits.js";
+import { ChunkQueue } from "./utils/streams.js";
+import { ValueErr } from "./utils/errors.js";
+import { ResultAssembler } from "./utils/reducers.js";
+import {
+  MemoryBudget,
+  SpilledResult,
+  createSpillStore,
+  estimateWorkingSet,
+} from "./utils/memory.js";
+import { ResultMemo, hashFiles } from "./utils/memoize.js";
+import { heapUsed } from "./utils/metrics.js";
+import { IncrementalSession } from "./utils/incremental.js";
+import { jsScripts, jsVersion } from "../javascript/jsScripts.js";
+import { avScripts, avVersion } from "../wasm/modules/modules.js";
+import { gpuScripts, gpuVersion } from "../webgpu/gpuScripts.js";
+import { nativeScripts, nativeVersion } from "../native/nativeThread.js";
 
 /**
  * @class
@@ -11,7 +24,7 @@ import { gpuScripts } from "../webgpu/gpuScripts.js";
  * @description main engine driver for all the available modules in the hydrocompute library
  * @property results - array with results
  * @property execTime - execution time of the running tasks
- * @property engineName - name of the engine running (javascript, wasm, webgpu)
+ * @property engineName - name of the engine running (javascript, wasm, webgpu, native)
  * @property workerLocation - location of worker script per engine
  * @param {String} engine - name of engine running the workers
  * @param {String} workerLocation - location of the worker script running the data
@@ -20,6 +33,23 @@ export default class engine {
   constructor(engine, workerLocation) {
     this.setEngine();
     this.workerLocation = workerLocation;
+    //Unlimited by default. Retained results are spilled into a local store when a budget is set and exceeded.
+    this.memory = new MemoryBudget({
+      spill: (bytes) => this.spillResults(bytes),
+    });
+    this.spillStore = null;
+    this.spillCount = 0;
+    //Content-addressed memo of kernel results, disabled unless a ResultMemo is attached
+    this.memo = null;
+    //Hashes of the kernel artifacts by engine and script, versioning the memo keys
+    this.kernelVersions = new Map();
+    //Timeline of the tasks, recorded only when a Tracer is attached
+    this.tracer = null;
+    //Counters, histograms and gauges of the tasks, recorded only when a Metrics registry is attached
+    this.metrics = null;
+    this.seed = null;
+    //Resumable kernel states per data id, updated by append instead of full reruns
+    this.sessions = new Map();
     this.initialize(engine);
   }
 
@@ -67,10 +97,23 @@ export default class engine {
       isSplit = [],
       //Name of the script used from the passed arguments.
       scriptName = [],
+      //If set, chained functions stream chunks between them instead of waiting for the whole dataset.
+      //Either true or an object with the number of chunks and queue capacity: { chunks, capacity }
+      pipeline = false,
+      //Reducer used to reassemble the chunks of split steps. See the reducers namespace.
+      reduce = "concat",
+      //Seed of the run, part of the memo keys of the seeded kernels
+      seed = null,
+      //If set, resumable functions keep their state per step so that later appends update it in O(chunk)
+      incremental = false,
+      //Identifier of the data of each step, under which the incremental state is kept
+      sessions = [],
     } = args;
 
     //The total number of steps will be infered from the number of functions per step.
     let steps = functions.length;
+    this.memory.reset();
+    this.seed = seed;
 
     let stepArgs = [];
 
@@ -105,13 +148,27 @@ export default class engine {
         threadCount: thisThreadCount,
         dependencies: thisDep,
         length: thisDataLength,
-        scriptName: thisScriptName
+        scriptName: thisScriptName,
+        pipeline,
+        reduce,
+        //Linked steps consume the outputs of the previous step, which are not kept incrementally
+        incremental: incremental && !linked,
+        session: sessions[i],
       });
     }
 
     try {
+      //Linked steps are fused into a single chunk-level pipeline
+      if (linked && pipeline) {
+        await this.pipelineRun({
+          stages: stepArgs.flatMap((stepArg) => this.pipelineStages(stepArg)),
+          data: stepArgs[0].data,
+          length: stepArgs[0].length,
+          ...(typeof pipeline === "object" ? pipeline : {}),
+        });
+      }
       //Evluate the execution as a set of trailing down promises that resolve on after the other
-      if (linked) {
+      else if (linked) {
         var stepResolve = [];
 
         for (var i = 0; i < stepArgs.length; i++) {
@@ -164,14 +221,56 @@ export default class engine {
       isSplit = false,
       length = 1,
       threadCount = 0,
-      scriptName = undefined
+      scriptName = undefined,
+      pipeline = false,
+      reduce = "concat",
+      incremental = false,
+      session = undefined,
     } = args;
 
+    //A new run over the series replaces any state kept from earlier ones
+    typeof session !== "undefined" ? this.sessions.delete(session) : null;
+    //Resumable functions keep their state for later appends. The outputs of the run come from the kernels of the
+    //engine, except for the reductions that only exist as resumable kernels
+    if (
+      incremental &&
+      typeof session !== "undefined" &&
+      dependencies.length === 0 &&
+      !isSplit &&
+      length <= 1 &&
+      IncrementalSession.supports(functions)
+    ) {
+      const state = new IncrementalSession(functions, funcArgs);
+      if (state.local) {
+        this.sessions.set(session, state);
+        return this.append({ session, data });
+      }
+      //The state is built before the data is transferred into the workers
+      const outputs = state.append(data);
+      this.sessions.set(session, state);
+      if (state.kernels.some((kernel) => kernel.local)) {
+        return this.mixedRun(args, state, outputs);
+      }
+    }
+
+    //Chained functions within a step can stream their chunks through each other
+    if (pipeline && functions.length > 1 && dependencies.length > 0) {
+      return this.pipelineRun({
+        stages: this.pipelineStages(args),
+        data,
+        length,
+        ...(typeof pipeline === "object" ? pipeline : {}),
+      });
+    }
+
     for (var i = 0; i < threadCount; i++) {
       this.threads.createWorkerThread(i);
     }
 
-    let dataSplits = [];
+    let dataSplits = [],
+      halo = null,
+      layout = null,
+      assembler = null;
 
     //EXAMPLE CASE: If there are multiple functions that do not depend of each other
     //assume that the work can be parallelized
@@ -180,9 +279,24 @@ export default class engine {
         dataSplits = data;
         break;
       case functions.length > 0 && dependencies.length === 0 && isSplit:
-        dataSplits = splits.main("split1DArray", {
+        //Chunks are views over the step data extended with the halo each kernel needs at its edges
+        halo = halos.resolve(functions, funcArgs);
+        layout = splits.layout1D({
+          length: data.length,
+          n: functions.length,
+          halo,
+        });
+        dataSplits = splits.main("split1DView", {
           data: data,
           n: functions.length,
+          halo,
+          shared: true,
+        });
+        assembler = new ResultAssembler({
+          count: functions.length,
+          reducer: reduce,
+          layout,
+          halo,
         });
         break;
       case functions.length > 0 && dependencies.length === 0 && !isSplit:
@@ -207,7 +321,8 @@ export default class engine {
       funcArgs,
       threadCount,
       length,
-      scriptName
+      scriptName,
+      assembler
     };
 
     try {
@@ -223,6 +338,43 @@ export default class engine {
     }
   }
 
+  /**
+   * @method mixedRun
+   * @memberof engine
+   * @description Runs an incremental step holding reductions along with engine kernels. The engine kernels run as a
+   * step of their own, and the outputs of the reductions, taken from the primed state, are placed among theirs in the
+   * order of the functions of the step.
+   * @param {Object} args - arguments of the step, see stepRun
+   * @param {IncrementalSession} state - state of the step, primed with its data
+   * @param {Array} outputs - outputs of the state for the data of the step
+   * @returns {Promise} Resolves once the engine kernels have finished.
+   */
+  async mixedRun(args, state, outputs) {
+    const { functions, funcArgs = [], scriptName = [] } = args,
+      remote = functions.map((_, j) => j).filter((j) => !state.kernels[j].local),
+      pick = (values) => remote.map((j) => values[j]);
+    const r = await this.stepRun({
+      ...args,
+      functions: pick(functions),
+      funcArgs: pick(funcArgs),
+      scriptName: Array.isArray(scriptName) ? pick(scriptName) : scriptName,
+      threadCount: remote.length,
+      incremental: false,
+      session: undefined,
+    });
+    //Results of the workers come in the order they finished, and are matched back by function name
+    const step = this.results[this.results.length - 1],
+      taken = step.funcOrder.map(() => false);
+    step.results = functions.map((fn, j) => {
+      if (state.kernels[j].local) return outputs[j];
+      const k = step.funcOrder.findIndex((name, i) => !taken[i] && name === fn);
+      taken[k] = true;
+      return step.results[k];
+    });
+    step.funcOrder = [...functions];
+    return r;
+  }
+
 /**
  * Runs multiple tasks concurrently using worker threads and dependency graph.
  * @param {object} args - The arguments for concurrent execution.
@@ -234,9 +386,7 @@ export default class engine {
     async concurrentRun(args, step, dependencies) {
       let batchTasks = []
       for (var i = 0; i < args.threadCount; i++) {
-        let d = args.data.buffer !== undefined
-        ? args.data.buffer
-        : args.data[i].buffer;
+        let d = args.data.buffer !== undefined ? args.data : args.data[i];
         var _args = {
           //data: Array.isArray(args.data[0]) ? args.data[i] : args.data,
           data: d,
@@ -253,7 +403,7 @@ export default class engine {
       try {
         let res = await DAG({
           functions: Object.keys(this.threads.workerThreads).map((key) => {
-            return this.threads.workerThreads[key].worker;
+            return (taskArgs) => this.admittedTask(key, taskArgs);
           }),
           dag: dependencies,
           args: batchTasks,
@@ -279,7 +429,9 @@ export default class engine {
  * @returns {Promise<Array>} - A promise that resolves to an array of results.
  */
   async parallelRun(args, step) {
-    const batches = [];
+    //Every task of the step is queued from the start, later batches wait for the earlier ones
+    const queued = wallClock(),
+      batches = [];
     let results = [];
     let last = 0;
 
@@ -303,21 +455,28 @@ export default class engine {
       for (var i = 0; i < batch.functions.length; i++) {
         let j = last + i;
         //item changed, check it out later
-        let d =
-          args.data.buffer !== undefined
-            ? args.data.buffer
-            : args.data[j].buffer;
+        let d = args.data.buffer !== undefined ? args.data : args.data[j];
         let workerArgs = {
           data: d,
           id: i,
-          funcName: args.functions[i],
-          funcArgs: args.funcArgs[i],
+          funcName: args.functions[j],
+          funcArgs: args.funcArgs[j],
           step,
           length: args.length,
-          scriptName: args.scriptName[i]
+          scriptName: args.scriptName[j]
         };
         this.threads.initializeWorkerThread(i);
-        batchTasks.push(this.threads.workerThreads[i].worker(workerArgs));
+        //Chunks are handed to the reassembly stage as soon as each worker finishes
+        batchTasks.push(
+          this.admittedTask(i, workerArgs, true, queued).then((res) => {
+            if (args.assembler) {
+              const start = wallClock();
+              args.assembler.add(j, res);
+              this.traceSpan("reassemble", start, { step, funcName: args.functions[j], worker: i });
+            }
+            return res;
+          })
+        );
       }
       let batchResults = await Promise.all(batchTasks);
       results = results.concat(batchResults);
@@ -326,6 +485,371 @@ export default class engine {
     return results;
   }
 
+  /**
+   * @method pipelineStages
+   * @memberof engine
+   * @description Resolves the functions of a step into an ordered list of pipeline stages. Only steps with
+   * a single function or a linear chain of dependencies ([[], [0], [1]...]) can be pipelined.
+   * @param {Object} args - step arguments as built in the run method
+   * @returns {Array} stages as { funcName, funcArgs, scriptName }
+   * @throws {ValueErr} if the dependencies of the step are not a linear chain
+   */
+  pipelineStages({ functions = [], funcArgs = [], dependencies = [], scriptName = [] }) {
+    const linear = dependencies.every(
+      (dep, j) => (j === 0 ? dep.length === 0 : dep.length === 1 && dep[0] === j - 1)
+    );
+    if (functions.length > 1 && (!linear || dependencies.length !== functions.length)) {
+      throw new ValueErr(
+        "Only single functions or linear chains of functions can be pipelined."
+      );
+    }
+    return functions.map((funcName, j) => ({
+      funcName,
+      funcArgs: funcArgs[j],
+      scriptName: Array.isArray(scriptName) ? scriptName[j] : scriptName,
+    }));
+  }
+
+  /**
+   * @method pipelineRun
+   * @memberof engine
+   * @description Runs a chain of functions with chunk-level dataflow. The data is cut into chunks that are fed
+   * into a bounded queue; each stage pulls chunks from its input queue as they arrive, runs them on its own set
+   * of workers and pushes the output into the next queue. Full queues hold back the upstream stage, so only a few
+   * chunks per stage are resident at once and the chain runs at the pace of its slowest stage.
+   * Chunks overlap by the halos of all the stages (see halos) and every stage trims its output to the values that
+   * match a full run, keeping the halo of the stages after it, so the output equals that of a full run.
+   * @throws {ValueErr} if the data holds several series or a stage is neither elementwise nor halo-registered
+   * @param {Object} args - pipeline arguments
+   * @param {Array} args.stages - ordered stages as returned by pipelineStages
+   * @param {Float32Array} args.data - 1D series to stream through the stages
+   * @param {Number} [args.length=1] - number of series in the data. Only single series are supported.
+   * @param {Number} [args.chunks] - number of chunks the data is cut into. Defaults to twice the workers in use.
+   * @param {Number} [args.capacity] - maximum chunks held between two stages. Defaults to the workers per stage.
+   * @returns {Promise<Array>} resolves to an array holding the buffer of the reassembled output.
+   */
+  async pipelineRun({ stages, data, length = 1, chunks, capacity }) {
+    if (length > 1) {
+      throw new ValueErr("Pipelined runs require a single 1D series.");
+    }
+    data = data instanceof Float32Array ? data : new Float32Array(data);
+
+    //Chunks read the halos of every stage, each stage consuming its own
+    const stageHalos = stages.map(({ funcName, funcArgs }) => halos.resolve([funcName], [funcArgs])),
+      halo = stageHalos.reduce(
+        (total, { left, right }) => ({ left: total.left + left, right: total.right + right }),
+        { left: 0, right: 0 }
+      );
+
+    const stageCount = stages.length,
+      lanes = Math.max(
+        1,
+        Math.floor(this.threads.maxWorkerCount / stageCount)
+      ),
+      chunkCount = Math.max(1, chunks || lanes * stageCount * 2),
+      layout = splits
+        .layout1D({ length: data.length, n: chunkCount, halo })
+        .filter(({ start, end }) => end > start),
+      queues = Array.from(
+        { length: stageCount + 1 },
+        () => new ChunkQueue(capacity || lanes)
+      );
+
+    const abortAll = (error) => {
+      for (let q of queues) q.abort(error);
+      throw error;
+    };
+
+    //Chunks are cut lazily so that backpressure also bounds the copies made from the input
+    const feed = async () => {
+      for (let i = 0; i < layout.length; i++) {
+        const { start, end, left, right } = layout[i];
+        await queues[0].push({
+          index: i,
+          data: data.slice(start - left, end + right),
+          from: start - left,
+          start,
+          end,
+          length: data.length,
+          queued: wallClock(),
+        });
+      }
+      queues[0].close();
+    };
+
+    const stage = async (s) => {
+      const { funcName, funcArgs, scriptName } = stages[s];
+      const lane = async (l) => {
+        const slot = s * lanes + l;
+        this.threads.createWorkerThread(slot);
+        for await (let chunk of queues[s]) {
+          if (chunk.data.length === 0) {
+            await queues[s + 1].push(chunk);
+            continue;
+          }
+          this.threads.initializeWorkerThread(slot, { retain: false });
+          //The input is transferred into the worker
+          const size = chunk.data.length;
+          let out = await this.admittedTask(
+            slot,
+            {
+              data: chunk.data.buffer,
+              id: slot,
+              funcName,
+              funcArgs,
+              step: s,
+              length: 1,
+              scriptName,
+            },
+            false,
+            chunk.queued
+          );
+          out = new Float32Array(out);
+          if (out.length > size) {
+            throw new ValueErr(`${funcName} returned more values than it was given and cannot be pipelined.`);
+          }
+          await queues[s + 1].push({
+            index: chunk.index,
+            ...splits.trimStage({ chunk, size, output: out, halo: stageHalos[s] }),
+            queued: wallClock(),
+          });
+        }
+      };
+      await Promise.all(Array.from({ length: lanes }, (_, l) => lane(l)));
+      queues[s + 1].close();
+    };
+
+    const collect = async () => {
+      let parts = [];
+      for await (let { index, data, from, start, end } of queues[stageCount]) {
+        parts[index] = data.subarray(Math.max(0, start - from), end - from);
+      }
+      const start = wallClock(),
+        result = parts.length > 0 ? concatArrays(parts) : new Float32Array(0);
+      this.traceSpan("reassemble", start, { funcName: stages.map((st) => st.funcName).join(" > ") });
+      return result;
+    };
+
+    try {
+      let [, , result] = await Promise.all([
+        feed().catch(abortAll),
+        Promise.all(stages.map((_, s) => stage(s).catch(abortAll))),
+        collect().catch(abortAll),
+      ]);
+
+      [this.funcEx, this.scriptEx] = this.threads.execTimes;
+      this.results.push({
+        results: [result.buffer],
+        funcEx: this.funcEx,
+        scriptEx: this.scriptEx,
+        funcOrder: [stages.map((st) => st.funcName).join(" > ")],
+        timings: this.threads.timings,
+        memory: this.threads.memoryUse,
+      });
+      return [result.buffer];
+    } catch (error) {
+      console.error("There was an error executing the pipelined run.");
+      throw error;
+    } finally {
+      this.threads.resetWorkers();
+    }
+  }
+
+  /**
+   * @method append
+   * @memberof engine
+   * @description Routes values appended to a series into the incremental state kept for it, updating the outputs
+   * of its resumable functions in O(chunk). The outputs are added to the results like those of a step.
+   * @param {Object} args - append arguments
+   * @param {String} args.session - identifier of the series, as given to the run
+   * @param {Float32Array|Array} args.data - appended values
+   * @returns {Boolean} true if the series had an incremental state, false if it must be recomputed instead
+   */
+  append({ session, data }) {
+    const state = this.sessions.get(session);
+    if (typeof state === "undefined") return false;
+    const start = performance.now(),
+      results = state.append(data),
+      elapsed = performance.now() - start;
+    this.results.push({
+      results,
+      funcEx: elapsed,
+      scriptEx: elapsed,
+      funcOrder: [...state.functions],
+    });
+    return true;
+  }
+
+  /**
+   * @method admittedTask
+   * @memberof engine
+   * @description Runs a worker task once its estimated working set fits in the memory budget.
+   * @param {Number} index - thread running the task
+   * @param {Object} workerArgs - arguments passed into the worker
+   * @param {Boolean} [retained=true] - whether the thread manager keeps the result of the task
+   * @param {Number} [queued] - wall clock time the task was queued at. Defaults to now.
+   * @returns {Promise<ArrayBuffer>} result of the task
+   */
+  async admittedTask(index, workerArgs, retained = true, queued = wallClock()) {
+    const data = workerArgs.data,
+      inputBytes =
+        data && typeof data.byteLength === "number"
+          ? data.byteLength
+          : (data ? data.length : 0) * Float32Array.BYTES_PER_ELEMENT,
+      bytes = estimateWorkingSet(this.threads.engine, workerArgs.funcName, inputBytes);
+    //The key is taken before the input is transferred into the worker
+    const key = this.memo !== null ? await this.memoKey(workerArgs) : null;
+    if (key !== null) {
+      const hit = await this.memo.get(key);
+      if (hit !== null) {
+        if (retained) {
+          this.threads.results.push(hit.slice(0));
+          this.threads.functionOrder.push(workerArgs.funcName);
+          this.memory.release(0, hit.byteLength);
+        }
+        this.metrics !== null ? this.metrics.count("memo.hits") : null;
+        return hit;
+      }
+    }
+    await this.memory.acquire(bytes);
+    const meta = { queued };
+    this.metrics !== null ? this.metrics.adjust("workers.busy", 1) : null;
+    try {
+      let res = await this.threads.workerThreads[index].worker(workerArgs, meta);
+      this.tracer !== null && meta.timing ? this.tracer.task(this.threads.engine, meta.timing) : null;
+      this.memory.release(bytes, retained ? res.byteLength : 0);
+      this.metrics !== null ? this.recordTask(meta, inputBytes, res.byteLength) : null;
+      key !== null ? await this.memo.set(key, res) : null;
+      return res;
+    } catch (error) {
+      this.memory.release(bytes);
+      this.metrics !== null ? this.recordTask(meta, inputBytes, 0, true) : null;
+      throw error;
+    }
+  }
+
+  /**
+   * @method recordTask
+   * @memberof engine
+   * @description Records a finished worker task into the attached metrics.
+   * @param {Object} meta - task metadata filled by the thread manager: timing, stats, memory and allocations
+   * @param {Number} inputBytes - bytes sent into the worker
+   * @param {Number} outputBytes - bytes received back
+   * @param {Boolean} [failed=false] - whether the task threw
+   */
+  recordTask({ timing, stats = {}, memory = {}, allocations = 0 }, inputBytes, outputBytes, failed = false) {
+    const m = this.metrics;
+    m.adjust("workers.busy", -1);
+    m.count(failed ? "tasks.failed" : "tasks");
+    m.count("bytes.in", inputBytes);
+    m.count("bytes.out", outputBytes);
+    m.count("allocations", allocations + (stats.allocations || 0));
+    m.gauge("memory.inUse", this.memory.inUse);
+    const heap = heapUsed();
+    heap !== null ? m.gauge("heap.used", heap) : null;
+    if (typeof timing !== "undefined") {
+      m.observe("queue.wait", Math.max(0, timing.spawned - timing.queued));
+      typeof timing.startFunction === "number" && typeof timing.endFunction === "number"
+        ? m.observe(`latency.${timing.funcName}`, Math.max(0, timing.endFunction - timing.startFunction))
+        : null;
+    }
+    memory.grows ? m.count("memory.grows", memory.grows) : null;
+    typeof memory.heapPeak === "number" && typeof timing !== "undefined"
+      ? m.observe(`heapPeak.${timing.funcName}`, memory.heapPeak)
+      : null;
+    stats.iterations ? m.count("kernel.iterations", stats.iterations) : null;
+    //HC_NOT_CONVERGED in hydrocompute.h
+    stats.status === 1 ? m.count("kernel.notConverged") : null;
+  }
+
+  /**
+   * @method memoKey
+   * @memberof engine
+   * @description Content-addressed key of a worker task for the result memo.
+   * @param {Object} workerArgs - arguments passed into the worker
+   * @returns {Promise<String|null>} memo key, or null if the kernel has no version to key it by
+   */
+  async memoKey({ data, funcName, funcArgs, scriptName, length }) {
+    const version = await this.kernelVersion(scriptName);
+    if (version === null) return null;
+    return this.memo.key({
+      engine: this.threads.engine,
+      funcName,
+      version,
+      scriptName,
+      funcArgs,
+      seed: this.seed,
+      length,
+      data:
+        data instanceof ArrayBuffer || ArrayBuffer.isView(data)
+          ? data
+          : new Float32Array(data || []),
+    });
+  }
+
+  /**
+   * @method kernelVersion
+   * @memberof engine
+   * @description Version of the kernels run by a task: the hash of the script passed by the user, or else of the
+   * artifacts of the engine (module binaries, addon or script files), so that memoized results are never served once
+   * a kernel is rebuilt or edited. Hashed once per engine and script.
+   * @param {String} [scriptName] - script holding the function, relative to the root of the library
+   * @returns {Promise<String|null>} hash of the artifacts, or null if they could not be read
+   */
+  kernelVersion(scriptName) {
+    const engine = this.threads.engine,
+      name = `${engine}:${scriptName || ""}`;
+    if (!this.kernelVersions.has(name)) {
+      let version;
+      if (scriptName) version = hashFiles([new URL(`../../${scriptName}`, import.meta.url)]);
+      else if (engine === "javascript") version = jsVersion();
+      else if (engine === "wasm") version = avVersion();
+      else if (engine === "webgpu") version = gpuVersion();
+      else if (engine === "native") version = nativeVersion();
+      else version = Promise.resolve(null);
+      this.kernelVersions.set(name, Promise.resolve(version).catch(() => null));
+    }
+    return this.kernelVersions.get(name);
+  }
+
+  /**
+   * @method traceSpan
+   * @memberof engine
+   * @description Adds a span of the main thread to the tracer, if one is attached.
+   * @param {String} name - span name
+   * @param {Number} start - wall clock start in ms, the span ends now
+   * @param {Object} [args] - tags of the span
+   */
+  traceSpan(name, start, args = {}) {
+    this.tracer !== null ? this.tracer.span(this.threads.engine, name, start, wallClock(), args) : null;
+  }
+
+  /**
+   * @method spillResults
+   * @memberof engine
+   * @description Moves retained results into the local spill store, oldest first, leaving SpilledResult handles in place.
+   * @param {Number} needed - bytes that should be freed
+   * @returns {Promise<Number>} bytes freed
+   */
+  async spillResults(needed) {
+    this.spillStore = this.spillStore || createSpillStore();
+    if (this.spillStore === null) return 0;
+    let freed = 0;
+    const holders = [...this.results.map((r) => r.results), this.threads.results];
+    for (let holder of holders) {
+      for (let k = 0; k < holder.length && freed < needed; k++) {
+        const res = holder[k];
+        if (!(res instanceof ArrayBuffer) || res.byteLength === 0) continue;
+        const key = `${this.threads.engine}-${Date.now()}-${this.spillCount++}`;
+        //The handle is set before writing so that concurrent spills skip this result
+        holder[k] = new SpilledResult(key, res.byteLength, this.spillStore);
+        freed += res.byteLength;
+        await this.spillStore.put(key, res);
+      }
+    }
+    return freed;
+  }
+
 /**
  * Executes tasks based on the provided dependencies and step counter.
  * @param {object} args - The arguments for task execution.
@@ -344,7 +868,17 @@ export default class engine {
         // Parallel Execution
         x = await this.parallelRun(args, stepCounter);
       }
-      if (args.threadCount === this.threads.results.length) {
+      //Split runs keep a single output, reassembled in chunk order with the halos removed
+      if (args.assembler) {
+        const start = wallClock();
+        this.threads.results = [args.assembler.result().buffer];
+        this.traceSpan("reassemble", start, { step: stepCounter, funcName: args.functions[0] });
+        this.threads.functionOrder = [[...new Set(args.functions)].join(", ")];
+      }
+      if (
+        args.threadCount === this.threads.results.length ||
+        args.assembler
+      ) {
         [this.funcEx, this.scriptEx] = this.threads.execTimes;
   
         this.results.push({
@@ -352,12 +886,10 @@ export default class engine {
           results: this.threads.results,
           funcEx: this.funcEx,
           scriptEx: this.scriptEx,
-          funcOrder: this.threads.functionOrder
+          funcOrder: this.threads.functionOrder,
+          timings: this.threads.timings,
+          memory: this.threads.memoryUse,
         });
-  
-        console.log(
-          `Total function execution time: ${this.funcEx} ms\nTotal worker execution time: ${this.scriptEx} ms`
-        );
         this.threads.resetWorkers();
       }
       return x;
@@ -395,5 +927,6 @@ export default class engine {
     if (this.engineName === "javascript") return jsScripts();
     if (this.engineName === "wasm") return avScripts();
     if (this.engineName === "webgpu") return gpuScripts();
+    if (this.engineName === "native") return nativeScripts();
   }
 }
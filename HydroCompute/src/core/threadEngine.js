@@ -1,23 +1,32 @@
+import { createWorker, hardwareConcurrency, workersAvailable } from "./utils/runtime.js";
+import { wallClock } from "./utils/globalUtils.js";
+import { NativeThread } from "../native/nativeThread.js";
+
 /**
  * @description Main class for managing threads. Results and execution time are saved here
  * @property engine - name of the engine
  * @property workerLocation - location of the worker running the engine
  * @property workerThreads - holder for all the worker threads
- * @property maxWorkerCount - maximum workers on the browser Leave it at least 1 less than all the available.
+ * @property maxWorkerCount - maximum workers on the host. Leave it at least 1 less than all the available.
+ * @property workerLimit - maximum workers set by the user, overriding the default of maxWorkerCount. Null if unset.
  * @property results - holder of the results once finished
+ * @property timings - wall clock times of each task run since the last reset, see taskPhases in globalUtils
+ * @property memoryUse - memory used by each task run since the last reset, as reported by the wasm and native kernels:
+ * heap size and growth, memory.grow calls, allocations, allocated bytes, and peak heap and stack use
  * @class threadManager
  * @param {string} name - The name of the thread manager.
  * @param {string} location - The location of the worker script file.
  */
 export default class threadManager {
   constructor(name, location) {
-    window.Worker
+    workersAvailable()
       ? console.log(`Web workers engine set for engine: ${name}`)
       : (() => {
           return console.error("Web workers API not supported!");
         })();
     this.engine = name;
     this.workerLocation = location;
+    this.workerLimit = null;
     this.resetWorkers();
     console.log(
       `Initialized ${this.engine} using worker scope with max number of parallel threads:${this.maxWorkerCount}`
@@ -42,20 +51,54 @@ export default class threadManager {
    * @memberof threadManager
    * @description Method initializer of the threads found in the workerThread object. It attaches each of the properties into the object.
    * @param {Number} index - number of the thread.
+   * @param {Object} [options] - thread options
+   * @param {Boolean} [options.retain=true] - if false, the result is only resolved to the caller and not kept in the manager results.
    */
-  initializeWorkerThread(index) {
-    this.workerThreads[index].worker = (args) => {
+  initializeWorkerThread(index, { retain = true } = {}) {
+    //The task timeline is also handed back in meta.timing, along with the time the task was queued at, and the
+    //statistics and memory use of the kernel in meta.stats and meta.memory
+    this.workerThreads[index].worker = (args, meta = {}) => {
       let { data, funcName, step } = args;
-      let buffer;
-      if (data instanceof ArrayBuffer) {
+      let buffer,
+        byteOffset = 0,
+        elementCount = undefined;
+      meta.allocations = 0;
+      if (
+        data instanceof ArrayBuffer ||
+        (typeof SharedArrayBuffer !== "undefined" &&
+          data instanceof SharedArrayBuffer)
+      ) {
         buffer = data;
-      } else if (data.buffer instanceof ArrayBuffer) {
-        buffer = data.buffer;
+      } else if (ArrayBuffer.isView(data)) {
+        if (
+          typeof SharedArrayBuffer !== "undefined" &&
+          data.buffer instanceof SharedArrayBuffer
+        ) {
+          //Shared views are passed as offsets into the same memory, no copy is made
+          buffer = data.buffer;
+          byteOffset = data.byteOffset;
+          elementCount = data.length;
+        } else if (
+          data.byteOffset === 0 &&
+          data.byteLength === data.buffer.byteLength
+        ) {
+          buffer = data.buffer;
+        } else {
+          //Views over a larger buffer cannot be transferred without detaching their siblings
+          buffer = data.slice().buffer;
+          meta.allocations += 1;
+        }
       } else {
         // Convert to ArrayBuffer
         const float32Array = new Float32Array(data);
         buffer = float32Array.buffer;
+        meta.allocations += 1;
       }
+      args = { ...args, data: buffer, byteOffset, elementCount };
+
+      //Main thread side of the task timeline, completed with the marks sent back by the worker
+      const spawned = wallClock(),
+        timing = { step, id: index, funcName, queued: meta.queued || spawned, spawned };
 
       return new Promise(async (resolve, reject) => {
         let w;
@@ -64,30 +107,43 @@ export default class threadManager {
         //   importScripts(this.workerLocation);
         //   w = self;
         // } else {
-        if (this.engine === "webgpu") {
-          w = new Worker(new URL("../../src/webgpu/wgpu.worker.js", import.meta.url), {
-            type: "module",
-          });
+        //Web Workers in browsers, worker_threads under Node.js
+        if (this.engine === "native") {
+          //Kernels run through the addon on the libuv threadpool, the buffer is read in place. Kernels running next to
+          //others of the same step take a single OpenMP thread each
+          w = new NativeThread();
+          args.threads =
+            Math.min(Object.keys(this.workerThreads).length, this.maxWorkerCount) > 1 ? 1 : 0;
+        } else if (this.engine === "webgpu") {
+          w = createWorker(new URL("../../src/webgpu/wgpu.worker.js", import.meta.url));
         } else if (this.engine === "wasm") {
-          w = new Worker(new URL("../../src/wasm/wasm.worker.js", import.meta.url), {
-            type: "module",
-          });
+          w = createWorker(new URL("../../src/wasm/wasm.worker.js", import.meta.url));
         } else {
-          w = new Worker(new URL("../../src/javascript/js.worker.js", import.meta.url), {
-            type: "module",
-          });
+          w = createWorker(new URL("../../src/javascript/js.worker.js", import.meta.url));
         }
 
         // }
+        timing.created = wallClock();
         w.onmessage = ({ data }) => {
-          console.log(`working...`);
-          let { results, funcExec, workerExec, funcName } = data;
+          timing.received = wallClock();
+          let { results, funcExec, workerExec, funcName, marks = {}, stats = {}, memory = {} } = data;
+          meta.timing = { ...timing, ...marks };
+          meta.stats = stats;
+          meta.memory = memory;
+          Object.keys(memory).length > 0
+            ? this.memoryUse.push({ step, id: index, funcName, ...memory })
+            : null;
+          //Copies of the result handed to the caller and kept in the manager
+          meta.allocations += retain ? 2 : 1;
+          this.timings.push(meta.timing);
           //Workaround to obtain result buffer and save it.
           resolve(results.slice(0));
-          this.results.push(results.slice(0));
+          if (retain) {
+            this.results.push(results.slice(0));
+            this.functionOrder.push(funcName);
+          }
           (this.workerThreads[index].functionTime += funcExec),
             (this.workerThreads[index].workerTime += workerExec);
-          this.functionOrder.push(funcName);
           w.terminate();
         };
         w.onerror = (error) => {
@@ -100,9 +156,10 @@ export default class threadManager {
         };
 
         try {
-          buffer.byteLength === 0
+          buffer.byteLength === 0 || !(buffer instanceof ArrayBuffer)
             ? w.postMessage(args)
             : w.postMessage(args, [buffer]);
+          timing.posted = wallClock();
         } catch (error) {
           console.error(
             `There was an error with the execution of function: ${funcName}, step: ${step}.`
@@ -119,10 +176,23 @@ export default class threadManager {
    * @description Resets all the workers set to work in the compute engine.
    */
   resetWorkers() {
-    this.maxWorkerCount = navigator.hardwareConcurrency - 1;
+    this.maxWorkerCount =
+      this.workerLimit !== null ? this.workerLimit : Math.max(1, hardwareConcurrency() - 1);
     this.workerThreads = {};
     this.results = [];
     this.functionOrder = [];
+    this.timings = [];
+    this.memoryUse = [];
+  }
+
+  /**
+   * @memberof threadManager
+   * @description Limits the number of workers running at the same time. Tasks beyond the limit run in later batches.
+   * @param {Number|null} count - maximum number of workers, or null to use all but one of the available cores.
+   */
+  setWorkerLimit(count) {
+    this.workerLimit = count === null ? null : Math.max(1, Math.floor(count));
+    this.resetWorkers();
   }
 
   /**
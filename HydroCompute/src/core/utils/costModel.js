@@ -0,0 +1,365 @@
+import { ValueErr } from "./errors.js";
+
+/**
+ * @namespace costModel
+ * @description Measured cost model for the kernels available across engines. The same operation is usually
+ * implemented in several engines (e.g. JavaScript, AssemblyScript and C compiled into Web Assembly) with very
+ * different speeds. A calibration pass times each implementation over a range of input sizes, and the model is
+ * then used to route function calls to the fastest implementation and to decide whether splitting pays off.
+ */
+
+/**
+ * @description Input generator for kernels taking a single series.
+ * @memberof costModel
+ * @param {Number} n - number of elements
+ * @returns {Object} { data, length }
+ */
+const series = (n) => ({
+  data: Float32Array.from({ length: n }, (_, i) => 10 + Math.sin(i / 24) + Math.random()),
+  length: 1,
+});
+
+/**
+ * @description Input generator for kernels taking two square matrices with about n elements each.
+ * @memberof costModel
+ * @param {Number} n - number of elements per matrix
+ * @returns {Object} { data, length }
+ */
+const matrixPair = (n) => {
+  const side = Math.max(1, Math.floor(Math.sqrt(n)));
+  return {
+    data: Float32Array.from({ length: 2 * side * side }, () => Math.random()),
+    length: 2,
+  };
+};
+
+/**
+ * @member operations
+ * @memberof costModel
+ * @description Equivalent implementations of each operation per engine, the reference first. Chunkable operations
+ * can be split across workers (elementwise or with a halo declared in the halos registry). New implementations should
+ * be listed here to take part in the automatic engine selection, and are only routed to once their outputs agree with
+ * those of the reference during calibration. The linear weighted averages are left out until both of them run.
+ */
+export const operations = {
+  matrixMultiply: {
+    input: matrixPair,
+    chunkable: false,
+    implementations: [
+      { engine: "javascript", funcName: "matrixMultiply_js" },
+      { engine: "wasm", funcName: "_matrixMultiply_c" },
+      { engine: "native", funcName: "_matrixMultiply_c" },
+      { engine: "wasm", funcName: "matrixMultiplication" },
+      { engine: "webgpu", funcName: "matrixMultiply_gpu" },
+    ],
+  },
+  //matrixAdd_js leaves two holes at the front of its output and _matrixAddition_c only adds the first row
+  matrixAdd: {
+    input: matrixPair,
+    chunkable: false,
+    implementations: [
+      { engine: "wasm", funcName: "matrixAdd" },
+      { engine: "webgpu", funcName: "matrixAdd_gpu" },
+    ],
+  },
+  simpleMovingAverage: {
+    input: series,
+    chunkable: true,
+    implementations: [
+      { engine: "javascript", funcName: "simpleMovingAverage_js" },
+      { engine: "wasm", funcName: "simpleMovingAverage" },
+    ],
+  },
+  expoMovingAverage: {
+    input: series,
+    chunkable: true,
+    implementations: [
+      { engine: "javascript", funcName: "expoMovingAverage_js" },
+      { engine: "wasm", funcName: "exponentialMovingAverage" },
+    ],
+  },
+  dspItrend: {
+    input: series,
+    chunkable: true,
+    implementations: [
+      //The AssemblyScript dispItrend returns twice the values, most of them non-finite
+      { engine: "javascript", funcName: "dspItrend_js" },
+    ],
+  },
+  boxcox: {
+    input: series,
+    chunkable: true,
+    implementations: [
+      { engine: "wasm", funcName: "_boxcox_transform" },
+      { engine: "native", funcName: "_boxcox_transform" },
+    ],
+  },
+  linearDetrend: {
+    input: series,
+    chunkable: false,
+    implementations: [
+      { engine: "wasm", funcName: "_linear_detrend" },
+      { engine: "native", funcName: "_linear_detrend" },
+    ],
+  },
+  acf: {
+    input: series,
+    chunkable: false,
+    implementations: [
+      { engine: "wasm", funcName: "_acf" },
+      { engine: "native", funcName: "_acf" },
+    ],
+  },
+  arima: {
+    input: series,
+    chunkable: false,
+    implementations: [
+      { engine: "wasm", funcName: "_arima_autoParams" },
+      { engine: "native", funcName: "_arima_autoParams" },
+    ],
+  },
+  monteCarlo: {
+    input: series,
+    chunkable: false,
+    implementations: [
+      { engine: "wasm", funcName: "_monteCarlo_c" },
+      { engine: "native", funcName: "_monteCarlo_c" },
+    ],
+  },
+};
+
+/**
+ * @method findOperation
+ * @memberof costModel
+ * @description Finds the operation that a function name implements.
+ * @param {String} name - operation name or the name of any of its implementations
+ * @returns {String|null} operation name
+ */
+export const findOperation = (name) => {
+  if (Object.keys(operations).includes(name)) return name;
+  for (let [op, { implementations }] of Object.entries(operations)) {
+    if (implementations.some((impl) => impl.funcName === name)) return op;
+  }
+  return null;
+};
+
+/**
+ * @description Median of an array of numbers.
+ * @memberof costModel
+ */
+const median = (values) => {
+  const sorted = [...values].sort((a, b) => a - b),
+    mid = sorted.length >> 1;
+  return sorted.length % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+};
+
+/**
+ * @description Checks that an output agrees with the reference output over the same input: same length, non-finite
+ * values in the same positions and the finite values within a tolerance relative to the largest reference value.
+ * @memberof costModel
+ * @param {Float32Array} output - output of the implementation
+ * @param {Float32Array} reference - output of the reference implementation
+ * @param {Number} tolerance - relative tolerance
+ * @returns {Boolean} whether they agree
+ */
+const agrees = (output, reference, tolerance) => {
+  if (output.length !== reference.length) return false;
+  let scale = 0;
+  for (let i = 0; i < reference.length; i++) {
+    Number.isFinite(reference[i]) ? (scale = Math.max(scale, Math.abs(reference[i]))) : null;
+  }
+  const limit = tolerance * Math.max(scale, 1e-6);
+  for (let i = 0; i < reference.length; i++) {
+    if (Number.isFinite(output[i]) !== Number.isFinite(reference[i])) return false;
+    if (Number.isFinite(reference[i]) && Math.abs(output[i] - reference[i]) > limit) return false;
+  }
+  return true;
+};
+
+/**
+ * @description Piecewise log-log interpolation over measured points, extrapolating with the closest segment.
+ * @memberof costModel
+ * @param {Array} points - measured points as { n, value } sorted by n
+ * @param {Number} n - size to predict
+ * @returns {Number} predicted value
+ */
+const interpolate = (points, n) => {
+  if (points.length === 1) return (points[0].value * n) / points[0].n;
+  let i = points.findIndex((p) => p.n >= n);
+  i = i <= 0 ? 1 : i;
+  i = Math.min(i, points.length - 1);
+  const a = points[i - 1],
+    b = points[i],
+    lv = (v) => Math.log(Math.max(v, 1e-6)),
+    slope = (lv(b.value) - lv(a.value)) / (Math.log(b.n) - Math.log(a.n));
+  return Math.exp(lv(a.value) + slope * (Math.log(n) - Math.log(a.n)));
+};
+
+/**
+ * @class CostModel
+ * @memberof costModel
+ * @description Holds the measured timings per implementation and predicts the cost of a call.
+ * Kernel time (function execution inside the worker) and overhead (worker spawn, module load and
+ * data transfers) are kept apart so that the cost of splitting across workers can be estimated.
+ * @param {Object} [points={}] - previously measured points, as produced by toJSON
+ */
+export class CostModel {
+  constructor(points = {}) {
+    this.points = points;
+  }
+
+  /**
+   * @method calibrate
+   * @memberof costModel.CostModel
+   * @description Benchmarks every available implementation of every operation over the given sizes.
+   * Every implementation is fed the same inputs, and its outputs are compared with those of the first implementation
+   * that ran, in the order of the operation. Implementations that fail (e.g. engine not available) or disagree with
+   * the reference are skipped.
+   * @param {Object} args - calibration arguments
+   * @param {Function} args.runner - async (engine, funcName, input) => { funcEx, wall, output } timing a single call
+   * @param {Array} [args.engines] - engines to calibrate. Defaults to all engines.
+   * @param {Array} [args.ops] - operations to calibrate. Defaults to all operations.
+   * @param {Array} [args.sizes=[1024, 16384, 262144]] - input sizes
+   * @param {Number} [args.repeats=3] - repetitions per size, the median is kept
+   * @param {Number} [args.tolerance=1e-3] - error allowed against the reference, relative to its largest value
+   * @returns {Promise<CostModel>} the calibrated model
+   */
+  async calibrate({
+    runner,
+    engines = null,
+    ops = Object.keys(operations),
+    sizes = [1024, 16384, 262144],
+    repeats = 3,
+    tolerance = 1e-3,
+  }) {
+    for (let op of ops) {
+      const inputs = sizes.map((n) => operations[op].input(n)),
+        references = new Array(sizes.length).fill(null);
+      for (let impl of operations[op].implementations) {
+        if (engines !== null && !engines.includes(impl.engine)) continue;
+        const id = `${impl.engine}:${impl.funcName}`,
+          measured = [],
+          outputs = [];
+        try {
+          for (let k = 0; k < sizes.length; k++) {
+            const kernel = [],
+              wall = [];
+            for (let r = 0; r < repeats; r++) {
+              //Inputs are copied as they are transferred into the workers
+              const { data, length } = inputs[k],
+                timing = await runner(impl.engine, impl.funcName, { data: data.slice(), length });
+              kernel.push(timing.funcEx);
+              wall.push(timing.wall);
+              r === 0 ? outputs.push(timing.output) : null;
+            }
+            measured.push({ n: sizes[k], kernel: median(kernel), wall: median(wall) });
+          }
+        } catch (error) {
+          console.warn(`Skipping ${id} during calibration.`, error);
+          continue;
+        }
+        if (outputs.some((output, k) => references[k] !== null && !agrees(output, references[k], tolerance))) {
+          console.warn(`Skipping ${id} during calibration, its outputs disagree with the reference of ${op}.`);
+          continue;
+        }
+        outputs.forEach((output, k) => (references[k] === null ? (references[k] = output) : null));
+        this.points[op] = this.points[op] || {};
+        this.points[op][id] = measured;
+      }
+    }
+    return this;
+  }
+
+  /**
+   * @method predict
+   * @memberof costModel.CostModel
+   * @description Predicts the cost of running an implementation over n elements.
+   * @param {String} op - operation name
+   * @param {String} id - implementation id as engine:funcName
+   * @param {Number} n - number of elements
+   * @returns {Object} { kernel, overhead, total } in ms
+   */
+  predict(op, id, n) {
+    const measured = this.points[op] && this.points[op][id];
+    if (!measured || measured.length === 0) {
+      throw new ValueErr(`No measurements available for ${id}.`);
+    }
+    const kernel = interpolate(measured.map((p) => ({ n: p.n, value: p.kernel })), n),
+      overhead = Math.max(0, median(measured.map((p) => p.wall - p.kernel)));
+    return { kernel, overhead, total: kernel + overhead };
+  }
+
+  /**
+   * @method select
+   * @memberof costModel.CostModel
+   * @description Chooses the fastest measured implementation of a function for a given input size, and the
+   * number of workers to split it across if the operation is chunkable and splitting is predicted to pay off.
+   * @param {String} name - operation or function name
+   * @param {Number} n - number of elements
+   * @param {Object} [options] - selection options
+   * @param {Array} [options.engines] - restrict the selection to these engines
+   * @param {Number} [options.maxWorkers=1] - maximum number of workers a split can use
+   * @param {Number} [options.margin=0.1] - relative gain required to choose a split over a single worker
+   * @returns {Object|null} { op, engine, funcName, workers, predicted } or null if nothing has been measured
+   */
+  select(name, n, { engines = null, maxWorkers = 1, margin = 0.1 } = {}) {
+    const op = findOperation(name);
+    if (op === null || !this.points[op]) return null;
+    let best = null;
+    for (let id of Object.keys(this.points[op])) {
+      const [engine, funcName] = id.split(":");
+      if (engines !== null && !engines.includes(engine)) continue;
+      const { overhead, total } = this.predict(op, id, n);
+      let workers = 1,
+        predicted = total;
+      if (operations[op].chunkable) {
+        //Workers run concurrently, so a split costs one overhead plus the kernel over the largest chunk
+        for (let k = 2; k <= maxWorkers; k++) {
+          const split = overhead + this.predict(op, id, Math.ceil(n / k)).kernel;
+          if (split < predicted && split < total * (1 - margin)) {
+            workers = k;
+            predicted = split;
+          }
+        }
+      }
+      if (best === null || predicted < best.predicted) {
+        best = { op, engine, funcName, workers, predicted };
+      }
+    }
+    return best;
+  }
+
+  /**
+   * @method toJSON
+   * @memberof costModel.CostModel
+   * @returns {Object} measured points, to be stored and reloaded with the constructor
+   */
+  toJSON() {
+    return this.points;
+  }
+
+  /**
+   * @method save
+   * @memberof costModel.CostModel
+   * @description Stores the model in the local storage of the browser, if available.
+   * @param {String} [key="hydrocompute-cost-model"] - storage key
+   */
+  save(key = "hydrocompute-cost-model") {
+    typeof localStorage !== "undefined"
+      ? localStorage.setItem(key, JSON.stringify(this.points))
+      : null;
+  }
+
+  /**
+   * @method load
+   * @memberof costModel.CostModel
+   * @description Loads a model stored in the local storage of the browser.
+   * @param {String} [key="hydrocompute-cost-model"] - storage key
+   * @returns {CostModel|null} loaded model, or null if none is stored
+   */
+  static load(key = "hydrocompute-cost-model") {
+    if (typeof localStorage === "undefined") return null;
+    const stored = localStorage.getItem(key);
+    return stored === null ? null : new CostModel(JSON.parse(stored));
+  }
+}
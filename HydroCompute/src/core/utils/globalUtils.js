@@ -250,6 +250,69 @@ export const getPerformanceMeasures = () => {
       "start-script",
       "end-script"
     ).duration,
+    marks: getPerformanceMarks(),
+  };
+};
+
+/**
+ * @method wallClock
+ * @memberof globalUtils
+ * @description Current time in ms since the epoch, with the resolution of performance.now(). Unlike
+ * performance.now(), it can be compared across the main thread and the workers.
+ * @returns {number} - The current time.
+ */
+export const wallClock = () => performance.timeOrigin + performance.now();
+
+/**
+ * @method getPerformanceMarks
+ * @memberof globalUtils
+ * @description Wall clock times of the last marks set by a worker: start-script (message received), loaded-script
+ * (scripts or modules loaded), start-function and end-function (kernel), and end-script (results ready).
+ * @returns {object} - The times as startScript, loadedScript, startFunction, endFunction and endScript. Marks that
+ * were not set are left out.
+ */
+export const getPerformanceMarks = () => {
+  const marks = {};
+  for (let name of ["start-script", "loaded-script", "start-function", "end-function", "end-script"]) {
+    const entries = performance.getEntriesByName(name, "mark");
+    if (entries.length > 0) {
+      marks[name.replace(/-(\w)/, (_, c) => c.toUpperCase())] =
+        performance.timeOrigin + entries[entries.length - 1].startTime;
+    }
+  }
+  return marks;
+};
+
+/**
+ * @method taskPhases
+ * @memberof globalUtils
+ * @description Splits the time of a worker task recorded by the thread manager into its phases, in ms:
+ * queue (waiting for earlier batches, dependencies or memory), spawn (creating the worker until it takes the
+ * message), instantiate (loading scripts and modules), transferIn (posting the data and copying it into the kernel
+ * inputs), kernel, and transferOut (copying the results out and posting them back until they are received).
+ * @param {object} timing - The timing of the task, see threadManager.timings.
+ * @returns {object} - The duration of each phase. Phases whose marks are missing are 0.
+ */
+export const taskPhases = (timing) => {
+  const {
+      spawned,
+      queued = spawned,
+      created,
+      posted,
+      received,
+      startScript = posted,
+      loadedScript = startScript,
+      startFunction = loadedScript,
+      endFunction = startFunction,
+    } = timing,
+    span = (a, b) => Math.max(0, b - a);
+  return {
+    queue: span(queued, spawned),
+    spawn: span(spawned, created) + span(posted, startScript),
+    instantiate: span(startScript, loadedScript),
+    transferIn: span(created, posted) + span(loadedScript, startFunction),
+    kernel: span(startFunction, endFunction),
+    transferOut: span(endFunction, received),
   };
 };
 
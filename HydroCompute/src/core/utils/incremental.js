@@ -0,0 +1,240 @@
+import { summarize, mergeSummaries } from "./reducers.js";
+import { findOperation } from "./costModel.js";
+
+/**
+ * @namespace incremental
+ * @description Resumable kernels for append-only series. Each kernel keeps the state it needs to update its outputs
+ * from an appended chunk in O(chunk) instead of recomputing over the whole history. A resumable kernel implements
+ * init(...funcArgs) and append(state, chunk), where chunk is a Float32Array with the new values and the return value
+ * is a Float32Array: the outputs for the new values for streaming kernels (moving averages, detrend), or the updated
+ * output for the reductions. Streaming kernels give the outputs of the engine kernels for the new values, so the
+ * engines run the first pass over a series and the state only takes over its appends. Reductions have no engine
+ * kernel and are marked local, running on the main thread from the start. Kernels whose output depends on the whole
+ * series in a way a state cannot follow (ACF, Monte Carlo) are not resumable and are run again instead.
+ */
+
+/**
+ * @description Finalizes a partial summary into [count, mean, variance, min, max].
+ * @memberof incremental
+ */
+const summaryOutput = (s) =>
+  new Float32Array([s.count, s.mean, s.count > 0 ? s.m2 / s.count : 0, s.min, s.max]);
+
+/**
+ * @member resumable
+ * @memberof incremental
+ * @description Resumable kernels by operation name. Function names of the engines map to these through the
+ * operations registry of the cost model, e.g. simpleMovingAverage_js resumes as simpleMovingAverage.
+ */
+export const resumable = {
+  /**
+   * Running [count, mean, variance, min, max] of the series.
+   */
+  summary: {
+    local: true,
+    init: () => ({ summary: summarize([]) }),
+    append: (state, chunk) => {
+      state.summary = mergeSummaries(state.summary, summarize(chunk));
+      return summaryOutput(state.summary);
+    },
+  },
+
+  /**
+   * Running sum of the series.
+   */
+  sum: {
+    local: true,
+    init: () => ({ sum: 0 }),
+    append: (state, chunk) => {
+      for (let i = 0; i < chunk.length; i++) state.sum += chunk[i];
+      return new Float32Array([state.sum]);
+    },
+  },
+
+  /**
+   * Running minimum of the series.
+   */
+  min: {
+    local: true,
+    init: () => ({ min: Infinity }),
+    append: (state, chunk) => {
+      for (let i = 0; i < chunk.length; i++) state.min = Math.min(state.min, chunk[i]);
+      return new Float32Array([state.min]);
+    },
+  },
+
+  /**
+   * Running maximum of the series.
+   */
+  max: {
+    local: true,
+    init: () => ({ max: -Infinity }),
+    append: (state, chunk) => {
+      for (let i = 0; i < chunk.length; i++) state.max = Math.max(state.max, chunk[i]);
+      return new Float32Array([state.max]);
+    },
+  },
+
+  /**
+   * Box-Cox transform of the _boxcox_transform kernel, elementwise.
+   */
+  boxcox: {
+    init: (lambda = 0.5) => ({ lambda }),
+    append: (state, chunk) => {
+      const out = new Float32Array(chunk.length);
+      for (let i = 0; i < chunk.length; i++) {
+        out[i] =
+          state.lambda === 0 ? Math.log(chunk[i]) : (Math.pow(chunk[i], state.lambda) - 1) / state.lambda;
+      }
+      return out;
+    },
+  },
+
+  /**
+   * Trailing window average. Keeps the last window - 1 values, and emits one output per appended value once the
+   * first window is full, summed in the same order as the full kernel.
+   */
+  simpleMovingAverage: {
+    init: (window = 5) => ({ window, recent: [] }),
+    append: (state, chunk) => {
+      const { window } = state,
+        values = state.recent.concat(Array.from(chunk)),
+        out = new Float32Array(Math.max(0, values.length - window + 1));
+      for (let k = 0; k < out.length; k++) {
+        let sum = 0;
+        for (let i = k; i < k + window; i++) sum += values[i];
+        out[k] = sum / window;
+      }
+      state.recent = values.slice(Math.max(0, values.length - window + 1));
+      return out;
+    },
+  },
+
+  /**
+   * Exponential moving average, resumed from its last output.
+   */
+  expoMovingAverage: {
+    init: (alpha = 0.5) => ({ alpha, last: null }),
+    append: (state, chunk) => {
+      const out = new Float32Array(chunk.length);
+      for (let i = 0; i < chunk.length; i++) {
+        state.last =
+          state.last === null
+            ? chunk[i]
+            : state.alpha * chunk[i] + (1 - state.alpha) * state.last;
+        out[i] = state.last;
+      }
+      return out;
+    },
+  },
+
+  /**
+   * Instantaneous trend. The first output averages the first period values, so outputs are held back until the
+   * first period has arrived and then follow the recursion one value at a time.
+   */
+  dspItrend: {
+    init: (period = 7) => ({ period, head: [], avg: null }),
+    append: (state, chunk) => {
+      let values = Array.from(chunk),
+        out = [];
+      if (state.avg === null) {
+        state.head.push(...values);
+        if (state.head.length < state.period) return new Float32Array(0);
+        let sum = 0;
+        for (let i = 0; i < state.period; i++) sum += state.head[i];
+        state.avg = sum / state.period;
+        out.push(state.avg);
+        values = state.head.slice(1);
+        state.head = [];
+      }
+      for (let value of values) {
+        state.avg = (value - state.avg) * (2 / (state.period + 1)) + state.avg;
+        out.push(state.avg);
+      }
+      return new Float32Array(out);
+    },
+  },
+
+  /**
+   * Least squares detrending. Keeps the sums of the fit, so the trend is updated with every chunk and the appended
+   * values are returned detrended by it. The current fit is kept as slope and intercept in the state.
+   */
+  linearDetrend: {
+    init: () => ({ n: 0, sy: 0, sxy: 0, slope: 0, intercept: 0 }),
+    append: (state, chunk) => {
+      const start = state.n;
+      for (let i = 0; i < chunk.length; i++) {
+        state.sy += chunk[i];
+        state.sxy += (start + i) * chunk[i];
+      }
+      const n = (state.n += chunk.length),
+        sx = (n * (n - 1)) / 2,
+        sxx = ((n - 1) * n * (2 * n - 1)) / 6,
+        den = n * sxx - sx * sx;
+      state.slope = den === 0 ? 0 : (n * state.sxy - sx * state.sy) / den;
+      state.intercept = (state.sy - state.slope * sx) / n;
+      const out = new Float32Array(chunk.length);
+      for (let i = 0; i < chunk.length; i++) {
+        out[i] = chunk[i] - (state.slope * (start + i) + state.intercept);
+      }
+      return out;
+    },
+  },
+};
+
+/**
+ * @method findResumable
+ * @memberof incremental
+ * @description Finds the resumable kernel for a function name.
+ * @param {String} name - operation or function name of any engine
+ * @returns {Object|null} resumable kernel
+ */
+export const findResumable = (name) => {
+  if (typeof resumable[name] !== "undefined") return resumable[name];
+  const op = findOperation(name);
+  return op !== null && typeof resumable[op] !== "undefined" ? resumable[op] : null;
+};
+
+/**
+ * @class IncrementalSession
+ * @memberof incremental
+ * @description State of a set of resumable kernels over the same append-only series.
+ * @param {Array} functions - function names
+ * @param {Array} [funcArgs=[]] - arguments of each function
+ */
+export class IncrementalSession {
+  constructor(functions, funcArgs = []) {
+    this.functions = functions;
+    this.kernels = functions.map((name) => findResumable(name));
+    this.states = this.kernels.map((kernel, j) => {
+      const args = funcArgs[j];
+      return kernel.init(...(Array.isArray(args) ? args : args !== undefined ? [args] : []));
+    });
+    //Sessions of reductions only run on the main thread
+    this.local = this.kernels.every((kernel) => kernel.local === true);
+    this.length = 0;
+  }
+
+  /**
+   * @method supports
+   * @memberof incremental.IncrementalSession
+   * @param {Array} functions - function names
+   * @returns {Boolean} true if every function can be resumed
+   */
+  static supports(functions) {
+    return functions.length > 0 && functions.every((name) => findResumable(name) !== null);
+  }
+
+  /**
+   * @method append
+   * @memberof incremental.IncrementalSession
+   * @description Feeds new values into every kernel of the session.
+   * @param {Float32Array|Array} chunk - appended values
+   * @returns {Array} output buffer of each function
+   */
+  append(chunk) {
+    const values = chunk instanceof Float32Array ? chunk : Float32Array.from(chunk);
+    this.length += values.length;
+    return this.kernels.map((kernel, j) => kernel.append(this.states[j], values).buffer);
+  }
+}
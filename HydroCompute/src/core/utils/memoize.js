@@ -0,0 +1,325 @@
+import { IndexedDBStore, FileStore } from "./memory.js";
+import { readBinary } from "./runtime.js";
+
+/**
+ * @namespace memoize
+ * @description Content-addressed memoization of kernel results. A result is keyed by the kernel (engine, function,
+ * script and the hash of the artifact it runs from), the hash of the input contents, the additional arguments and,
+ * for kernels drawing from it, the seed of the run, so repeated jobs over unchanged data are served from an in-memory
+ * LRU or from a persistent local tier instead of recomputed.
+ */
+
+const PRIME32_1 = 0x9e3779b1,
+  PRIME32_2 = 0x85ebca77,
+  PRIME32_3 = 0xc2b2ae3d,
+  PRIME32_4 = 0x27d4eb2f,
+  PRIME32_5 = 0x165667b1;
+
+const rotl = (x, r) => (x << r) | (x >>> (32 - r));
+
+const round = (acc, lane) =>
+  Math.imul(rotl((acc + Math.imul(lane, PRIME32_2)) | 0, 13), PRIME32_1);
+
+/**
+ * @method xxhash32
+ * @memberof memoize
+ * @description xxHash32 of a byte array. Lanes are read four bytes at a time through a 32-bit view when the
+ * data is aligned, which keeps hashing far cheaper than any of the kernels it saves.
+ * @param {Uint8Array} bytes - data to hash
+ * @param {Number} [seed=0] - hash seed
+ * @returns {Number} unsigned 32-bit hash
+ */
+export const xxhash32 = (bytes, seed = 0) => {
+  const len = bytes.length,
+    aligned = bytes.byteOffset % 4 === 0,
+    words = aligned
+      ? new Uint32Array(bytes.buffer, bytes.byteOffset, len >>> 2)
+      : null,
+    word = (i) =>
+      aligned
+        ? words[i >>> 2]
+        : bytes[i] | (bytes[i + 1] << 8) | (bytes[i + 2] << 16) | (bytes[i + 3] << 24);
+  let i = 0,
+    h;
+  if (len >= 16) {
+    let v1 = (seed + PRIME32_1 + PRIME32_2) | 0,
+      v2 = (seed + PRIME32_2) | 0,
+      v3 = seed | 0,
+      v4 = (seed - PRIME32_1) | 0;
+    const limit = len - 16;
+    if (aligned) {
+      //Hot loop over the 32-bit view, kept free of the generic word reader
+      for (let w = 0; i <= limit; i += 16, w += 4) {
+        v1 = round(v1, words[w]);
+        v2 = round(v2, words[w + 1]);
+        v3 = round(v3, words[w + 2]);
+        v4 = round(v4, words[w + 3]);
+      }
+    } else {
+      for (; i <= limit; i += 16) {
+        v1 = round(v1, word(i));
+        v2 = round(v2, word(i + 4));
+        v3 = round(v3, word(i + 8));
+        v4 = round(v4, word(i + 12));
+      }
+    }
+    h = (rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18)) | 0;
+  } else {
+    h = (seed + PRIME32_5) | 0;
+  }
+  h = (h + len) | 0;
+  for (; i + 4 <= len; i += 4) {
+    h = Math.imul(rotl((h + Math.imul(word(i), PRIME32_3)) | 0, 17), PRIME32_4);
+  }
+  for (; i < len; i++) {
+    h = Math.imul(rotl((h + Math.imul(bytes[i], PRIME32_5)) | 0, 11), PRIME32_1);
+  }
+  h = Math.imul(h ^ (h >>> 15), PRIME32_2);
+  h = Math.imul(h ^ (h >>> 13), PRIME32_3);
+  return (h ^ (h >>> 16)) >>> 0;
+};
+
+/**
+ * @method hashContent
+ * @memberof memoize
+ * @description Hashes a buffer, typed array or string into a 64-bit hex digest (two seeded xxHash32 passes).
+ * @param {ArrayBuffer|TypedArray|String} data - content to hash
+ * @returns {String} hex digest
+ */
+export const hashContent = (data) => {
+  let bytes;
+  if (typeof data === "string") {
+    bytes = new TextEncoder().encode(data);
+  } else if (ArrayBuffer.isView(data)) {
+    bytes = new Uint8Array(data.buffer, data.byteOffset, data.byteLength);
+  } else {
+    bytes = new Uint8Array(data);
+  }
+  const hex = (h) => h.toString(16).padStart(8, "0");
+  return `${hex(xxhash32(bytes, 0))}${hex(xxhash32(bytes, PRIME32_3))}`;
+};
+
+/**
+ * @method hashFiles
+ * @memberof memoize
+ * @description Hashes the contents of files of the library, used as the version of the kernels they hold.
+ * @param {Array<URL|String>} locations - files to hash
+ * @returns {Promise<String>} hex digest
+ */
+export const hashFiles = async (locations) => {
+  const digests = await Promise.all(
+    locations.map((location) => readBinary(location).then(hashContent))
+  );
+  return hashContent(digests.join(":"));
+};
+
+/**
+ * @member seededKernels
+ * @memberof memoize
+ * @description Functions whose results depend on the seed of the run, the only ones keyed by it. The library kernels
+ * are deterministic: the simulations of _monteCarlo_c draw from streams fixed by their index.
+ */
+export const seededKernels = new Set();
+
+/**
+ * @class LRUCache
+ * @memberof memoize
+ * @description Least recently used cache of buffers bounded by total bytes.
+ * @param {Number} capacity - maximum bytes held by the cache
+ */
+export class LRUCache {
+  constructor(capacity) {
+    this.capacity = capacity;
+    this.bytes = 0;
+    this.entries = new Map();
+  }
+
+  /**
+   * @method get
+   * @memberof memoize.LRUCache
+   * @param {String} key - entry key
+   * @returns {ArrayBuffer|undefined} cached buffer, moved to the most recent position
+   */
+  get(key) {
+    const value = this.entries.get(key);
+    if (value !== undefined) {
+      this.entries.delete(key);
+      this.entries.set(key, value);
+    }
+    return value;
+  }
+
+  /**
+   * @method set
+   * @memberof memoize.LRUCache
+   * @description Adds a buffer, evicting the least recently used entries until it fits.
+   * @param {String} key - entry key
+   * @param {ArrayBuffer} value - buffer to cache
+   */
+  set(key, value) {
+    if (value.byteLength > this.capacity) return;
+    if (this.entries.has(key)) {
+      this.bytes -= this.entries.get(key).byteLength;
+      this.entries.delete(key);
+    }
+    while (this.bytes + value.byteLength > this.capacity) {
+      const [oldest, buffer] = this.entries.entries().next().value;
+      this.entries.delete(oldest);
+      this.bytes -= buffer.byteLength;
+    }
+    this.entries.set(key, value);
+    this.bytes += value.byteLength;
+  }
+
+  /**
+   * @method clear
+   * @memberof memoize.LRUCache
+   */
+  clear() {
+    this.entries.clear();
+    this.bytes = 0;
+  }
+}
+
+/**
+ * @class ResultMemo
+ * @memberof memoize
+ * @description Two-tier memo of kernel results: an in-memory LRU and an optional persistent local store
+ * (IndexedDB in browsers, files under Node). Entries are immutable, cached buffers are copied on the way out.
+ * Files of the persistent tier are bounded by size and age, removing the least recently used first.
+ * @param {Object} [args] - memo arguments
+ * @param {Number} [args.capacity=268435456] - bytes kept in memory
+ * @param {Boolean} [args.persistent=true] - whether results are also kept in the local store across runs
+ * @param {String} [args.directory] - directory of the persistent tier under Node
+ * @param {Number} [args.storeCapacity=1073741824] - bytes kept in the persistent tier under Node
+ * @param {Number} [args.maxAge=2592000000] - ms after which results of the persistent tier under Node are removed
+ */
+export class ResultMemo {
+  constructor({
+    capacity = 256 * 1024 ** 2,
+    persistent = true,
+    directory = null,
+    storeCapacity = 1024 ** 3,
+    maxAge = 30 * 24 * 3600 * 1000,
+  } = {}) {
+    this.cache = new LRUCache(capacity);
+    this.store = persistent ? ResultMemo.createStore(directory) : null;
+    this.bounds = { maxBytes: storeCapacity, maxAge };
+    //The persistent tier is pruned on the first write, then every sixteenth of its capacity written
+    this.written = Infinity;
+    this.hits = 0;
+    this.misses = 0;
+  }
+
+  /**
+   * @method createStore
+   * @memberof memoize.ResultMemo
+   * @description Creates the persistent tier suited to the current environment.
+   * @param {String} [directory] - directory of the store under Node
+   * @returns {Object|null} local store or null if none is available
+   */
+  static createStore(directory = null) {
+    if (typeof indexedDB !== "undefined") return new IndexedDBStore("hydrocompute-memo");
+    if (typeof process !== "undefined" && process.versions && process.versions.node) {
+      return new FileStore(directory, { name: "hydrocompute-memo", temporary: false });
+    }
+    return null;
+  }
+
+  /**
+   * @method key
+   * @memberof memoize.ResultMemo
+   * @description Content-addressed key of a kernel call.
+   * @param {Object} args - call description
+   * @param {String} args.engine - engine running the kernel
+   * @param {String} args.funcName - function name
+   * @param {String} args.version - hash of the artifact the kernel runs from
+   * @param {String} [args.scriptName] - script holding the function, if not from the library
+   * @param {*} [args.funcArgs] - additional arguments
+   * @param {*} [args.seed] - seed of the run, only keyed for the seeded kernels
+   * @param {Number} [args.length=1] - number of series or matrices the input holds
+   * @param {ArrayBuffer|TypedArray} args.data - input of the call
+   * @returns {String} key
+   */
+  key({ engine, funcName, version, scriptName = "", funcArgs = null, seed = null, length = 1, data }) {
+    return hashContent(
+      [
+        `${engine}:${scriptName || ""}:${funcName}@${version}`,
+        hashContent(data),
+        length,
+        JSON.stringify(funcArgs === undefined ? null : funcArgs),
+        JSON.stringify(seededKernels.has(funcName) ? seed : null),
+      ].join("|")
+    );
+  }
+
+  /**
+   * @method get
+   * @memberof memoize.ResultMemo
+   * @param {String} key - key of the call
+   * @returns {Promise<ArrayBuffer|null>} copy of the memoized result, or null on a miss
+   */
+  async get(key) {
+    let value = this.cache.get(key);
+    if (value === undefined && this.store !== null) {
+      try {
+        value = await this.store.get(key);
+        value ? this.cache.set(key, value) : null;
+        value && typeof this.store.touch === "function" ? await this.store.touch(key) : null;
+      } catch (error) {
+        value = undefined;
+      }
+    }
+    if (!value) {
+      this.misses += 1;
+      return null;
+    }
+    this.hits += 1;
+    return value.slice(0);
+  }
+
+  /**
+   * @method set
+   * @memberof memoize.ResultMemo
+   * @param {String} key - key of the call
+   * @param {ArrayBuffer} value - result of the call
+   * @returns {Promise<void>}
+   */
+  async set(key, value) {
+    const copy = value.slice(0);
+    this.cache.set(key, copy);
+    if (this.store !== null) {
+      try {
+        await this.store.put(key, copy);
+        this.written += copy.byteLength;
+        this.written >= this.bounds.maxBytes / 16 ? await this.prune() : null;
+      } catch (error) {
+        console.warn("The result could not be stored in the persistent memo.", error);
+      }
+    }
+  }
+
+  /**
+   * @method prune
+   * @memberof memoize.ResultMemo
+   * @description Bounds the persistent tier by size and age, if its store supports it.
+   * @returns {Promise<void>}
+   */
+  async prune() {
+    this.written = 0;
+    if (this.store !== null && typeof this.store.prune === "function") {
+      await this.store.prune(this.bounds);
+    }
+  }
+
+  /**
+   * @method clear
+   * @memberof memoize.ResultMemo
+   * @description Clears the in-memory tier and the hit counters.
+   */
+  clear() {
+    this.cache.clear();
+    this.hits = 0;
+    this.misses = 0;
+  }
+}
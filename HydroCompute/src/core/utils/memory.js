@@ -0,0 +1,427 @@
+/**
+ * @namespace memory
+ * @description Memory accounting for the engine. Tasks are admitted within a configurable budget using the working set
+ * estimated from the kernel and the size of its input. Results kept by the engine count against the same budget and
+ * are spilled into a local store (IndexedDB in browsers, files under Node) when new tasks would not fit otherwise.
+ */
+
+/**
+ * @member footprints
+ * @memberof memory
+ * @description Estimated working set of a task. The engine factor is the number of input-sized buffers resident while a
+ * task runs (transferred input, copies into the worker or the wasm heap, output and its copies back). Kernel entries add
+ * the scratch memory of kernels that allocate beyond their input and output. Both can be extended.
+ */
+export const footprints = {
+  engines: {
+    //Float32 input, the boxed array copy used by the scripts (8+ bytes per element) and the output
+    javascript: 5,
+    //Input, heap input, heap output and the output copy
+    wasm: 4,
+    //Input, mapped GPU buffers and the output
+    webgpu: 4,
+  },
+  kernels: {
+    //Three scratch arrays from hc_malloc, each the size of the input
+    _pacf: (bytes) => 3 * bytes,
+    //Stack arrays for the simulations and one year of variates
+    _monteCarlo_c: () => (10000 + 365) * 4,
+    //Output matrix of the size of one of the inputs
+    _matrixMultiply_c: (bytes) => bytes / 2,
+    _bmm: (bytes) => bytes / 2,
+    matrixMultiply_js: (bytes) => 4 * bytes,
+  },
+};
+
+/**
+ * @method estimateWorkingSet
+ * @memberof memory
+ * @description Estimates the bytes a task keeps resident while it runs.
+ * @param {String} engine - name of the engine running the task
+ * @param {String} funcName - name of the function
+ * @param {Number} bytes - size of the input in bytes
+ * @returns {Number} estimated working set in bytes
+ */
+export const estimateWorkingSet = (engine, funcName, bytes) => {
+  const factor = footprints.engines[engine] || 4,
+    scratch = footprints.kernels[funcName];
+  return factor * bytes + (typeof scratch === "function" ? scratch(bytes) : 0);
+};
+
+/**
+ * @class MemoryBudget
+ * @memberof memory
+ * @description Admission control over a memory budget. Running tasks reserve their working set until they finish,
+ * and retained results stay accounted until they are spilled or the budget is reset. A task larger than the whole
+ * budget is admitted alone so that it cannot wait forever.
+ * @param {Object} [args] - budget arguments
+ * @param {Number} [args.limit=Infinity] - budget in bytes
+ * @param {Function} [args.spill] - async (bytes) => freed, asked to release retained memory when a task does not fit
+ */
+export class MemoryBudget {
+  constructor({ limit = Infinity, spill = null } = {}) {
+    this.limit = limit;
+    this.spill = spill;
+    this.reset();
+  }
+
+  /**
+   * @method reset
+   * @memberof memory.MemoryBudget
+   * @description Clears the accounting, e.g. at the start of a run.
+   */
+  reset() {
+    this.running = 0;
+    this.retained = 0;
+    this.peak = 0;
+    this.spilled = 0;
+    this.waiting = [];
+  }
+
+  /**
+   * @memberof memory.MemoryBudget
+   * @description Bytes currently accounted against the budget.
+   */
+  get inUse() {
+    return this.running + this.retained;
+  }
+
+  /**
+   * @method acquire
+   * @memberof memory.MemoryBudget
+   * @description Reserves the working set of a task, spilling retained results or waiting for running tasks as needed.
+   * @param {Number} bytes - working set of the task
+   * @returns {Promise<void>} resolves once the task is admitted
+   */
+  async acquire(bytes) {
+    while (this.inUse + bytes > this.limit && this.inUse > 0) {
+      if (this.spill !== null && this.retained > 0) {
+        const freed = await this.spill(this.inUse + bytes - this.limit);
+        this.retained = Math.max(0, this.retained - freed);
+        this.spilled += freed;
+        if (freed > 0) continue;
+      }
+      if (this.running === 0) break;
+      await new Promise((resolve) => this.waiting.push(resolve));
+    }
+    this.running += bytes;
+    this.peak = Math.max(this.peak, this.inUse);
+  }
+
+  /**
+   * @method release
+   * @memberof memory.MemoryBudget
+   * @description Releases the working set of a finished task and accounts for the result it leaves behind.
+   * @param {Number} bytes - working set reserved by the task
+   * @param {Number} [retained=0] - bytes of the result kept by the engine
+   */
+  release(bytes, retained = 0) {
+    this.running = Math.max(0, this.running - bytes);
+    this.retained += retained;
+    this.peak = Math.max(this.peak, this.inUse);
+    for (let resolve of this.waiting.splice(0)) resolve();
+  }
+}
+
+/**
+ * @class SpilledResult
+ * @memberof memory
+ * @description Handle left in place of a result that has been moved into a spill store.
+ * @param {String} key - key of the result in the store
+ * @param {Number} byteLength - size of the spilled buffer
+ * @param {Object} store - spill store holding the result
+ */
+export class SpilledResult {
+  constructor(key, byteLength, store) {
+    this.spilled = true;
+    this.key = key;
+    this.byteLength = byteLength;
+    this.store = store;
+  }
+
+  /**
+   * @method load
+   * @memberof memory.SpilledResult
+   * @description Reads the result back from the store and removes it from there.
+   * @returns {Promise<ArrayBuffer>} spilled buffer
+   */
+  async load() {
+    const buffer = await this.store.get(this.key);
+    await this.store.delete(this.key);
+    return buffer;
+  }
+}
+
+/**
+ * @class IndexedDBStore
+ * @memberof memory
+ * @description Spill store backed by IndexedDB, for browsers and workers.
+ * @param {String} [name="hydrocompute-spill"] - database name
+ */
+export class IndexedDBStore {
+  constructor(name = "hydrocompute-spill") {
+    this.name = name;
+    this.db = null;
+  }
+
+  /**
+   * @method open
+   * @memberof memory.IndexedDBStore
+   * @description Opens the database, creating its object store the first time.
+   * @returns {Promise<IDBDatabase>} database
+   */
+  async open() {
+    if (this.db !== null) return this.db;
+    this.db = await new Promise((resolve, reject) => {
+      const request = indexedDB.open(this.name, 1);
+      request.onupgradeneeded = () => request.result.createObjectStore("results");
+      request.onsuccess = () => resolve(request.result);
+      request.onerror = () => reject(request.error);
+    });
+    return this.db;
+  }
+
+  /**
+   * @method request
+   * @memberof memory.IndexedDBStore
+   * @description Runs a single request over the object store of the database.
+   * @param {String} mode - transaction mode
+   * @param {Function} action - callback receiving the object store and returning the request
+   * @returns {Promise<*>} result of the request
+   */
+  async request(mode, action) {
+    const db = await this.open();
+    return new Promise((resolve, reject) => {
+      const request = action(db.transaction("results", mode).objectStore("results"));
+      request.onsuccess = () => resolve(request.result);
+      request.onerror = () => reject(request.error);
+    });
+  }
+
+  /**
+   * @method put
+   * @memberof memory.IndexedDBStore
+   * @param {String} key - key of the result
+   * @param {ArrayBuffer} buffer - result to store
+   */
+  put(key, buffer) {
+    return this.request("readwrite", (store) => store.put(buffer, key));
+  }
+
+  /**
+   * @method get
+   * @memberof memory.IndexedDBStore
+   * @param {String} key - key of the result
+   * @returns {Promise<ArrayBuffer>} stored result
+   */
+  get(key) {
+    return this.request("readonly", (store) => store.get(key));
+  }
+
+  /**
+   * @method delete
+   * @memberof memory.IndexedDBStore
+   * @param {String} key - key of the result
+   */
+  delete(key) {
+    return this.request("readwrite", (store) => store.delete(key));
+  }
+}
+
+/**
+ * @description Stores of the process holding a new temporary directory, removed on reset and when the process exits.
+ * @memberof memory
+ */
+const temporaryStores = new Set();
+let removeOnExit = null;
+
+/**
+ * @method trackTemporary
+ * @memberof memory
+ * @description Registers a store whose directory is removed when the process exits. Exit handlers run synchronously.
+ * @param {FileStore} store - store holding a temporary directory
+ */
+const trackTemporary = async (store) => {
+  temporaryStores.add(store);
+  if (removeOnExit !== null) return;
+  const { rmSync } = await import("node:fs");
+  removeOnExit = () => {
+    for (let { directory } of temporaryStores) rmSync(directory, { recursive: true, force: true });
+    temporaryStores.clear();
+  };
+  process.once("exit", removeOnExit);
+};
+
+/**
+ * @method removeTemporaryStores
+ * @memberof memory
+ * @description Removes the temporary directories of every store of the process, along with the results they hold.
+ * The stores create a new directory if they are written again.
+ * @returns {Promise<void>}
+ */
+export const removeTemporaryStores = async () => {
+  await Promise.all([...temporaryStores].map((store) => store.clear()));
+};
+
+/**
+ * @class FileStore
+ * @memberof memory
+ * @description Spill store writing each result as a file in a temporary directory, for Node.
+ * @param {String} [directory] - directory for the files. Defaults to a folder in the temporary directory.
+ * @param {Object} [options] - store options
+ * @param {String} [options.name="hydrocompute-spill"] - name of the default folder
+ * @param {Boolean} [options.temporary=true] - if true, the default folder is new and unique to this store, and is
+ * removed on reset and when the process exits. Otherwise the same folder is reused across processes, e.g. for results
+ * kept between runs.
+ */
+export class FileStore {
+  constructor(directory = null, { name = "hydrocompute-spill", temporary = true } = {}) {
+    this.directory = directory;
+    this.name = name;
+    this.temporary = temporary;
+    this.opening = null;
+  }
+
+  /**
+   * @method open
+   * @memberof memory.FileStore
+   * @description Loads the file system modules and creates the directory of the store if needed.
+   * @returns {Promise<String>} directory of the store
+   */
+  open() {
+    //Concurrent callers share the same initialization so that a single directory is created
+    this.opening =
+      this.opening ||
+      (async () => {
+        this.fs = await import("node:fs/promises");
+        this.path = await import("node:path");
+        if (this.directory === null && this.temporary) {
+          const os = await import("node:os");
+          this.directory = await this.fs.mkdtemp(
+            this.path.join(os.tmpdir(), `${this.name}-`)
+          );
+          await trackTemporary(this);
+          return this.directory;
+        }
+        if (this.directory === null) {
+          const os = await import("node:os");
+          this.directory = this.path.join(os.tmpdir(), this.name);
+        }
+        await this.fs.mkdir(this.directory, { recursive: true });
+        return this.directory;
+      })();
+    return this.opening;
+  }
+
+  /**
+   * @method put
+   * @memberof memory.FileStore
+   * @param {String} key - key of the result
+   * @param {ArrayBuffer} buffer - result to store
+   */
+  async put(key, buffer) {
+    const dir = await this.open(),
+      file = this.path.join(dir, key),
+      partial = `${file}.${process.pid}-${Date.now()}.partial`;
+    //Written aside and renamed so that readers never see a partial file
+    await this.fs.writeFile(partial, new Uint8Array(buffer));
+    await this.fs.rename(partial, file);
+  }
+
+  /**
+   * @method get
+   * @memberof memory.FileStore
+   * @param {String} key - key of the result
+   * @returns {Promise<ArrayBuffer>} stored result
+   */
+  async get(key) {
+    const dir = await this.open(),
+      file = await this.fs.readFile(this.path.join(dir, key));
+    return file.buffer.slice(file.byteOffset, file.byteOffset + file.byteLength);
+  }
+
+  /**
+   * @method delete
+   * @memberof memory.FileStore
+   * @param {String} key - key of the result
+   */
+  async delete(key) {
+    const dir = await this.open();
+    await this.fs.rm(this.path.join(dir, key), { force: true });
+  }
+
+  /**
+   * @method touch
+   * @memberof memory.FileStore
+   * @description Marks a result as recently used, see prune.
+   * @param {String} key - key of the result
+   */
+  async touch(key) {
+    const dir = await this.open(),
+      now = new Date();
+    await this.fs.utimes(this.path.join(dir, key), now, now);
+  }
+
+  /**
+   * @method prune
+   * @memberof memory.FileStore
+   * @description Removes the results older than maxAge, then the least recently used ones until the store holds at
+   * most maxBytes. Results are ordered by the time they were written or last touched.
+   * @param {Object} [bounds] - store bounds
+   * @param {Number} [bounds.maxBytes=Infinity] - bytes kept in the store
+   * @param {Number} [bounds.maxAge=Infinity] - age in ms after which results are removed
+   * @returns {Promise<Number>} bytes removed
+   */
+  async prune({ maxBytes = Infinity, maxAge = Infinity } = {}) {
+    const dir = await this.open(),
+      now = Date.now(),
+      files = [];
+    for (let name of await this.fs.readdir(dir)) {
+      if (name.endsWith(".partial")) continue;
+      try {
+        const { size, mtimeMs } = await this.fs.stat(this.path.join(dir, name));
+        files.push({ name, size, mtimeMs });
+      } catch (error) {
+        //Removed by another process meanwhile
+      }
+    }
+    files.sort((a, b) => a.mtimeMs - b.mtimeMs);
+    let total = files.reduce((sum, { size }) => sum + size, 0),
+      removed = 0;
+    for (let { name, size, mtimeMs } of files) {
+      if (total <= maxBytes && now - mtimeMs <= maxAge) break;
+      await this.fs.rm(this.path.join(dir, name), { force: true });
+      total -= size;
+      removed += size;
+    }
+    return removed;
+  }
+
+  /**
+   * @method clear
+   * @memberof memory.FileStore
+   * @description Removes the temporary directory of the store and everything in it. Other directories are kept.
+   */
+  async clear() {
+    if (!temporaryStores.has(this)) return;
+    const dir = this.directory;
+    temporaryStores.delete(this);
+    this.directory = null;
+    this.opening = null;
+    await this.fs.rm(dir, { recursive: true, force: true });
+  }
+}
+
+/**
+ * @method createSpillStore
+ * @memberof memory
+ * @description Creates the spill store suited to the current environment.
+ * @returns {Object|null} spill store, or null if no local store is available
+ */
+export const createSpillStore = () => {
+  if (typeof indexedDB !== "undefined") return new IndexedDBStore();
+  if (typeof process !== "undefined" && process.versions && process.versions.node) {
+    return new FileStore();
+  }
+  return null;
+};
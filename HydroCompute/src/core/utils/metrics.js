@@ -0,0 +1,190 @@
+import { isNode } from "./runtime.js";
+
+/**
+ * @namespace metrics
+ * @description Counters, histograms and gauges of the runs, to be queried programmatically instead of read from the
+ * console. Engines only record them when a Metrics instance is attached, so a disabled registry costs a null check
+ * per task.
+ *
+ * Recorded by the engines:
+ * - counters: tasks, tasks.failed, memo.hits, bytes.in, bytes.out, allocations, memory.grows, kernel.iterations and
+ *   kernel.notConverged.
+ * - histograms: latency.<function> (kernel time per function) and queue.wait, in ms, and heapPeak.<function> (peak
+ *   heap of the wasm and native kernels), in bytes.
+ * - gauges: workers.busy, memory.inUse (bytes reserved in the memory budget) and heap.used (JavaScript heap of the
+ *   main thread, where the runtime exposes it).
+ */
+
+/**
+ * @description Upper bounds of the histogram buckets: powers of two from 2^-10 to 2^53, covering times in ms from
+ * 1 µs and sizes in bytes. Values above the last bound fall into an overflow bucket.
+ * @memberof metrics
+ */
+export const bucketBounds = Array.from({ length: 64 }, (_, i) => 2 ** (i - 10));
+
+/**
+ * @class Histogram
+ * @memberof metrics
+ * @description Histogram over the fixed buckets in bucketBounds. Count, sum, minimum and maximum are exact, the
+ * percentiles are the upper bounds of the buckets they fall in.
+ */
+export class Histogram {
+  constructor() {
+    this.buckets = new Array(bucketBounds.length + 1).fill(0);
+    this.count = 0;
+    this.sum = 0;
+    this.min = Infinity;
+    this.max = -Infinity;
+  }
+
+  /**
+   * @method observe
+   * @memberof metrics.Histogram
+   * @param {Number} value - observed value
+   */
+  observe(value) {
+    //Buckets grow by powers of two, so the index is the binary exponent of the value
+    const index =
+      value <= bucketBounds[0] ? 0 : Math.min(bucketBounds.length, Math.ceil(Math.log2(value)) + 10);
+    this.buckets[index] += 1;
+    this.count += 1;
+    this.sum += value;
+    value < this.min ? (this.min = value) : null;
+    value > this.max ? (this.max = value) : null;
+  }
+
+  /**
+   * @method quantile
+   * @memberof metrics.Histogram
+   * @param {Number} q - quantile between 0 and 1
+   * @returns {Number} upper bound of the bucket holding the quantile, clamped to the observed range
+   */
+  quantile(q) {
+    if (this.count === 0) return 0;
+    const rank = Math.max(1, Math.ceil(q * this.count));
+    let seen = 0;
+    for (let i = 0; i < this.buckets.length; i++) {
+      seen += this.buckets[i];
+      if (seen >= rank) {
+        return Math.min(this.max, Math.max(this.min, i < bucketBounds.length ? bucketBounds[i] : this.max));
+      }
+    }
+    return this.max;
+  }
+
+  /**
+   * @method summary
+   * @memberof metrics.Histogram
+   * @returns {Object} count, sum, min, max, mean, p50, p90 and p99
+   */
+  summary() {
+    return {
+      count: this.count,
+      sum: this.sum,
+      min: this.count > 0 ? this.min : 0,
+      max: this.count > 0 ? this.max : 0,
+      mean: this.count > 0 ? this.sum / this.count : 0,
+      p50: this.quantile(0.5),
+      p90: this.quantile(0.9),
+      p99: this.quantile(0.99),
+    };
+  }
+}
+
+/**
+ * @method heapUsed
+ * @memberof metrics
+ * @description Bytes used by the JavaScript heap of the calling thread.
+ * @returns {Number|null} heap size, or null if the runtime does not expose it
+ */
+export const heapUsed = () => {
+  if (isNode) return process.memoryUsage().heapUsed;
+  //Chromium only
+  return typeof performance !== "undefined" && performance.memory ? performance.memory.usedJSHeapSize : null;
+};
+
+/**
+ * @class Metrics
+ * @memberof metrics
+ * @description Registry of the counters, histograms and gauges recorded by the engines it is attached to.
+ */
+export class Metrics {
+  constructor() {
+    this.reset();
+  }
+
+  /**
+   * @method count
+   * @memberof metrics.Metrics
+   * @param {String} name - counter name
+   * @param {Number} [value=1] - increment
+   */
+  count(name, value = 1) {
+    this.counters.set(name, (this.counters.get(name) || 0) + value);
+  }
+
+  /**
+   * @method observe
+   * @memberof metrics.Metrics
+   * @param {String} name - histogram name
+   * @param {Number} value - observed value
+   */
+  observe(name, value) {
+    let histogram = this.histograms.get(name);
+    if (typeof histogram === "undefined") {
+      histogram = new Histogram();
+      this.histograms.set(name, histogram);
+    }
+    histogram.observe(value);
+  }
+
+  /**
+   * @method gauge
+   * @memberof metrics.Metrics
+   * @description Sets a gauge, keeping the highest value it reached.
+   * @param {String} name - gauge name
+   * @param {Number} value - current value
+   */
+  gauge(name, value) {
+    const gauge = this.gauges.get(name);
+    typeof gauge === "undefined"
+      ? this.gauges.set(name, { value, max: value })
+      : ((gauge.value = value), (gauge.max = Math.max(gauge.max, value)));
+  }
+
+  /**
+   * @method adjust
+   * @memberof metrics.Metrics
+   * @description Adds to the current value of a gauge, e.g. +1 and -1 around a task.
+   * @param {String} name - gauge name
+   * @param {Number} delta - change of the gauge
+   */
+  adjust(name, delta) {
+    const gauge = this.gauges.get(name);
+    this.gauge(name, (typeof gauge === "undefined" ? 0 : gauge.value) + delta);
+  }
+
+  /**
+   * @method snapshot
+   * @memberof metrics.Metrics
+   * @returns {Object} counters, histogram summaries and gauges, keyed by name
+   */
+  snapshot() {
+    return {
+      counters: Object.fromEntries(this.counters),
+      histograms: Object.fromEntries([...this.histograms].map(([name, h]) => [name, h.summary()])),
+      gauges: Object.fromEntries([...this.gauges].map(([name, g]) => [name, { ...g }])),
+    };
+  }
+
+  /**
+   * @method reset
+   * @memberof metrics.Metrics
+   * @description Removes every metric recorded so far.
+   */
+  reset() {
+    this.counters = new Map();
+    this.histograms = new Map();
+    this.gauges = new Map();
+  }
+}
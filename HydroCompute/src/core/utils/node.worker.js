@@ -0,0 +1,15 @@
+import { parentPort, workerData } from "node:worker_threads";
+
+/**
+ * @description Bootstrap of the workers under Node.js. It provides the worker scope expected by the engine workers
+ * (self.onmessage and self.postMessage) over the worker_threads port and then loads the requested worker script.
+ * @memberof Workers
+ * @module NodeWorker
+ * @name NodeWorker
+ */
+globalThis.self = globalThis;
+self.postMessage = (message, transfer) => parentPort.postMessage(message, transfer);
+
+await import(workerData.url);
+
+parentPort.on("message", (data) => self.onmessage({ data }));
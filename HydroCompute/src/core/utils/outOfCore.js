@@ -0,0 +1,348 @@
+import { IncrementalSession, findResumable } from "./incremental.js";
+import { findOperation, operations } from "./costModel.js";
+import { splits, halos } from "./splits.js";
+import { FileStore, SpilledResult } from "./memory.js";
+import { isNode } from "./runtime.js";
+import { ValueErr } from "./errors.js";
+
+/**
+ * @namespace outOfCore
+ * @description Out-of-core execution for series and matrices larger than the memory of the engines. Data is read in
+ * windows from a local file (Node) or a Blob/File (browsers) holding little endian float32 values, so only a window,
+ * the state of the kernels and the outputs of the current window are resident. Each window runs on the kernels of the
+ * selected engine: chunkable kernels over the window and its halo, trimmed as in the split runs, and matrix products as
+ * a blocked GEMM over square tiles of both operands. Reductions resume from a window to the next through the
+ * incremental namespace. Kernels that cannot be split, such as detrending, are left out.
+ */
+
+/**
+ * @method openSource
+ * @memberof outOfCore
+ * @description Opens a source of float32 values for positioned reads.
+ * @param {String|URL|Blob} source - file path or URL under Node, or a Blob/File
+ * @returns {Promise<Object>} { length, read(offset, count, target), close() }, with offsets and counts in values
+ */
+export const openSource = async (source) => {
+  const bytes = Float32Array.BYTES_PER_ELEMENT;
+  if (typeof Blob !== "undefined" && source instanceof Blob) {
+    return {
+      length: Math.floor(source.size / bytes),
+      read: async (offset, count, target) => {
+        const buffer = await source.slice(offset * bytes, (offset + count) * bytes).arrayBuffer();
+        target.set(new Float32Array(buffer));
+      },
+      close: async () => {},
+    };
+  }
+  if (!isNode) {
+    throw new ValueErr("Out-of-core sources must be a Blob or File in browsers.");
+  }
+  const fs = await import("node:fs/promises"),
+    handle = await fs.open(source, "r"),
+    { size } = await handle.stat();
+  return {
+    length: Math.floor(size / bytes),
+    read: async (offset, count, target) => {
+      const view = new Uint8Array(target.buffer, target.byteOffset, count * bytes);
+      let done = 0;
+      while (done < view.length) {
+        const { bytesRead } = await handle.read(view, done, view.length - done, offset * bytes + done);
+        if (bytesRead === 0) break;
+        done += bytesRead;
+      }
+    },
+    close: () => handle.close(),
+  };
+};
+
+/**
+ * @class OutputSink
+ * @memberof outOfCore
+ * @description Output written window by window, into a file under Node or into a Blob in browsers. Once finished,
+ * it is kept in the results as a spilled result, loaded into memory on demand with restoreResults.
+ * @param {String} name - name of the output
+ * @param {String} [directory] - directory of the output file under Node. Defaults to a temporary directory.
+ */
+export class OutputSink {
+  constructor(name, directory = null) {
+    this.name = name;
+    this.byteLength = 0;
+    this.parts = [];
+    this.store = isNode
+      ? new FileStore(directory, { name: "hydrocompute-stream", temporary: directory === null })
+      : null;
+  }
+
+  /**
+   * @method write
+   * @memberof outOfCore.OutputSink
+   * @param {Float32Array} values - outputs of a window, copied before returning
+   */
+  async write(values) {
+    if (values.length === 0) return;
+    const bytes = new Uint8Array(values.buffer, values.byteOffset, values.byteLength);
+    if (this.store === null) {
+      this.parts.push(bytes.slice());
+    } else {
+      if (typeof this.handle === "undefined") {
+        const dir = await this.store.open();
+        this.file = this.store.path.join(dir, `${this.name}.f32`);
+        this.handle = await this.store.fs.open(this.file, "w");
+      }
+      await this.handle.write(bytes, 0, bytes.length, this.byteLength);
+    }
+    this.byteLength += bytes.length;
+  }
+
+  /**
+   * @method finish
+   * @memberof outOfCore.OutputSink
+   * @returns {Promise<SpilledResult>} handle of the output
+   */
+  async finish() {
+    if (typeof this.handle !== "undefined") await this.handle.close();
+    if (this.store === null) this.blob = new Blob(this.parts);
+    this.parts = [];
+    return new SpilledResult(this.name, this.byteLength, this);
+  }
+
+  /**
+   * @method get
+   * @memberof outOfCore.OutputSink
+   * @returns {Promise<ArrayBuffer>} the whole output
+   */
+  async get() {
+    if (this.store === null) return this.blob.arrayBuffer();
+    if (typeof this.file === "undefined") return new ArrayBuffer(0);
+    const file = await this.store.fs.readFile(this.file);
+    return file.buffer.slice(file.byteOffset, file.byteOffset + file.byteLength);
+  }
+
+  /**
+   * @method delete
+   * @memberof outOfCore.OutputSink
+   * @description Outputs stay on disk after being loaded, they are the product of the run.
+   */
+  async delete() {}
+}
+
+/**
+ * @method dispatch
+ * @memberof outOfCore
+ * @description Finds the engine and function name that run a function. Operation names take the implementation of the
+ * engine, and the automatic engine routes the function once for the whole source, so that every window runs on the
+ * same implementation and is trimmed with its halo.
+ * @param {Object} eng - engine or automatic engine of the run
+ * @param {String} name - function or operation name
+ * @param {Number} n - values per window
+ * @returns {Object} { engine, funcName }
+ */
+const dispatch = (eng, name, n) => {
+  if (typeof eng === "undefined" || eng === null) {
+    throw new ValueErr(`Out-of-core runs of ${name} need an engine.`);
+  }
+  if (eng.engineName === "auto") {
+    const route = eng.route([name], n, true);
+    return { engine: eng.backend(route.engine), funcName: route.functions[0] };
+  }
+  const impl =
+    typeof operations[name] !== "undefined"
+      ? operations[name].implementations.find(({ engine }) => engine === eng.engineName)
+      : undefined;
+  return { engine: eng, funcName: typeof impl !== "undefined" ? impl.funcName : name };
+};
+
+/**
+ * @method runKernel
+ * @memberof outOfCore
+ * @description Runs a function over a window as a single step of an engine. The window is transferred into the
+ * workers, so it must not be read afterwards.
+ * @param {Object} target - engine and function name, see dispatch
+ * @param {Float32Array} data - input of the step
+ * @param {Number} length - number of inputs held in data
+ * @param {Array} args - arguments of the function
+ * @returns {Promise<Object>} { output, funcEx }
+ */
+const runKernel = async ({ engine, funcName }, data, length, args) => {
+  await engine.run({
+    data: [data],
+    length: [length],
+    functions: [[funcName]],
+    funcArgs: [[args]],
+    dependencies: [],
+    isSplit: [false],
+    scriptName: [[]],
+  });
+  const { results, funcEx } = engine.results.pop();
+  return { output: new Float32Array(results[0]), funcEx };
+};
+
+/**
+ * @method runSeries
+ * @memberof outOfCore
+ * @description Runs functions over a series read in windows. Chunkable kernels run on the engine, each window being
+ * read with the halo of the kernel and trimmed to the outputs of a single pass, as in the split runs. Reductions have
+ * no engine kernel and resume from a window to the next on the main thread.
+ * @param {Object} args - run arguments
+ * @param {Object} args.source - source opened with openSource
+ * @param {Object} args.engine - engine running the kernels
+ * @param {Array} args.functions - function names, chunkable or reductions
+ * @param {Array} [args.funcArgs] - arguments of each function
+ * @param {Number} args.windowSize - values per window
+ * @param {String} [args.output] - directory of the streamed outputs under Node
+ * @param {String} args.name - prefix of the output names
+ * @returns {Promise<Object>} { results, funcEx }, with the output of each function as a buffer or a spilled result
+ */
+export const runSeries = async ({ source, engine, functions, funcArgs = [], windowSize, output, name }) => {
+  const local = functions.map((fn) => {
+      const kernel = findResumable(fn);
+      return kernel !== null && kernel.local === true;
+    }),
+    targets = functions.map((fn, j) =>
+      local[j] ? null : dispatch(engine, fn, Math.min(windowSize, source.length))
+    ),
+    //Kernels that cannot be split cannot be windowed either
+    stageHalos = targets.map((target, j) =>
+      target !== null ? halos.resolve([target.funcName], [funcArgs[j]]) : null
+    ),
+    left = Math.max(0, ...stageHalos.map((halo) => (halo !== null ? halo.left : 0))),
+    right = Math.max(0, ...stageHalos.map((halo) => (halo !== null ? halo.right : 0))),
+    session = local.some((isLocal) => isLocal)
+      ? new IncrementalSession(
+          functions.filter((_, j) => local[j]),
+          funcArgs.filter((_, j) => local[j])
+        )
+      : null,
+    sinks = functions.map((fn, j) => (local[j] ? null : new OutputSink(`${name}-${j}-${fn}`, output))),
+    buffer = new Float32Array(Math.min(windowSize + left + right, source.length)),
+    length = source.length;
+  let last = [],
+    funcEx = 0;
+  for (let start = 0; start < length; start += windowSize) {
+    const end = Math.min(start + windowSize, length),
+      from = Math.max(0, start - left),
+      to = Math.min(length, end + right);
+    await source.read(from, to - from, buffer.subarray(0, to - from));
+    session !== null ? (last = session.append(buffer.subarray(start - from, end - from))) : null;
+    for (let j = 0; j < functions.length; j++) {
+      if (local[j]) continue;
+      const halo = stageHalos[j],
+        chunkFrom = start - Math.min(halo.left, start),
+        input = buffer.slice(chunkFrom - from, Math.min(length, end + halo.right) - from),
+        size = input.length,
+        result = await runKernel(targets[j], input, 1, funcArgs[j]);
+      if (result.output.length > size) {
+        throw new ValueErr(`${functions[j]} returned more values than it was given and cannot be windowed.`);
+      }
+      const chunk = splits.trimStage({
+        chunk: { from: chunkFrom, start, end, length },
+        size,
+        output: result.output,
+        halo,
+      });
+      await sinks[j].write(chunk.data.subarray(Math.max(0, chunk.start - chunk.from), chunk.end - chunk.from));
+      funcEx += result.funcEx;
+    }
+  }
+  let k = 0;
+  const results = await Promise.all(
+    sinks.map((sink) => (sink !== null ? sink.finish() : last[k++] || new ArrayBuffer(0)))
+  );
+  return { results, funcEx };
+};
+
+/**
+ * @method runMatrixMultiply
+ * @memberof outOfCore
+ * @description Blocked product of two square matrices stored one after the other, row major, as for the in-memory
+ * matrix kernels. The result is computed by panels of rows: each panel of the first matrix is read once, the second
+ * matrix is streamed in panels of rows through it, and each pair of square tiles is multiplied by the matrix kernel of
+ * the engine, padded with zeros at the edges. The products are summed into the panel of the result, written out once
+ * finished. About windowSize values of each operand and of the result are resident at a time.
+ * @param {Object} args - run arguments
+ * @param {Object} args.source - source opened with openSource
+ * @param {Object} args.engine - engine running the tiles
+ * @param {String} args.funcName - matrix product, as an operation or a function name
+ * @param {Number} args.windowSize - values per panel
+ * @param {String} [args.output] - directory of the result under Node
+ * @param {String} args.name - name of the result
+ * @returns {Promise<Object>} { results, funcEx }, with the result matrix as a spilled result
+ */
+export const runMatrixMultiply = async ({ source, engine, funcName, windowSize, output, name }) => {
+  const side = Math.round(Math.sqrt(source.length / 2));
+  if (2 * side * side !== source.length) {
+    throw new ValueErr("Out-of-core matrix products need two square matrices stored one after the other.");
+  }
+  const rows = Math.max(1, Math.min(side, Math.floor(windowSize / side))),
+    target = dispatch(engine, funcName, 2 * rows * rows),
+    a = new Float32Array(rows * side),
+    b = new Float32Array(rows * side),
+    c = new Float32Array(rows * side),
+    sink = new OutputSink(name, output);
+  let funcEx = 0;
+  for (let i0 = 0; i0 < side; i0 += rows) {
+    const panel = Math.min(rows, side - i0);
+    await source.read(i0 * side, panel * side, a.subarray(0, panel * side));
+    c.fill(0);
+    for (let k0 = 0; k0 < side; k0 += rows) {
+      const block = Math.min(rows, side - k0);
+      await source.read(side * side + k0 * side, block * side, b.subarray(0, block * side));
+      for (let j0 = 0; j0 < side; j0 += rows) {
+        const width = Math.min(rows, side - j0),
+          tiles = new Float32Array(2 * rows * rows);
+        for (let i = 0; i < panel; i++) {
+          tiles.set(a.subarray(i * side + k0, i * side + k0 + block), i * rows);
+        }
+        for (let k = 0; k < block; k++) {
+          tiles.set(b.subarray(k * side + j0, k * side + j0 + width), rows * rows + k * rows);
+        }
+        const result = await runKernel(target, tiles, 2, []);
+        for (let i = 0; i < panel; i++) {
+          for (let j = 0; j < width; j++) c[i * side + j0 + j] += result.output[i * rows + j];
+        }
+        funcEx += result.funcEx;
+      }
+    }
+    await sink.write(c.subarray(0, panel * side));
+  }
+  return { results: [await sink.finish()], funcEx };
+};
+
+/**
+ * @method run
+ * @memberof outOfCore
+ * @description Runs functions over a source larger than memory, window by window on an engine.
+ * @param {Object} args - run arguments
+ * @param {String|URL|Blob} args.source - file path or URL under Node, or a Blob/File, holding float32 values
+ * @param {Object} args.engine - engine running the kernels, as set in the compute class
+ * @param {Array} args.functions - chunkable functions and reductions, or a single matrix product (matrixMultiply or
+ * any of its implementations)
+ * @param {Array} [args.funcArgs] - arguments of each function
+ * @param {Number} [args.windowSize=4194304] - values read at a time
+ * @param {String} [args.output] - directory of the streamed outputs under Node
+ * @param {String} [args.name="stream"] - prefix of the output names
+ * @returns {Promise<Object>} { results, funcEx, scriptEx, funcOrder }, in the layout of the engine results
+ */
+export const run = async ({
+  source,
+  engine,
+  functions,
+  funcArgs = [],
+  windowSize = 4 * 1024 * 1024,
+  output = null,
+  name = "stream",
+}) => {
+  const start = performance.now(),
+    opened = await openSource(source);
+  let ran;
+  try {
+    ran =
+      functions.length === 1 && findOperation(functions[0]) === "matrixMultiply"
+        ? await runMatrixMultiply({ source: opened, engine, funcName: functions[0], windowSize, output, name })
+        : await runSeries({ source: opened, engine, functions, funcArgs, windowSize, output, name });
+  } finally {
+    await opened.close();
+  }
+  const elapsed = performance.now() - start;
+  return { results: ran.results, funcEx: ran.funcEx, scriptEx: elapsed, funcOrder: [...functions] };
+};
@@ -0,0 +1,243 @@
+import { ValueErr, NotImplemented } from "./errors.js";
+import { concatArrays } from "./globalUtils.js";
+import { splits } from "./splits.js";
+
+/**
+ * @namespace reducers
+ * @description Reducers used to combine the results of a split run as the chunks arrive from the workers.
+ * Every reducer implements init({ count, sizes }), add(state, chunk, index) and finalize(state), where
+ * chunk is the Float32Array output of the chunk with the given index. Custom reducers following the
+ * same interface can be passed directly into a run.
+ */
+export const reducers = {
+  /**
+   * Places each chunk at its offset of the output. If the sizes of the chunks are known ahead,
+   * the output is preallocated and every chunk is written in place as soon as it arrives.
+   */
+  concat: {
+    init: ({ count, sizes = null }) => {
+      if (sizes === null) return { parts: new Array(count), out: null };
+      const offsets = new Array(count);
+      let total = 0;
+      for (let i = 0; i < count; i++) {
+        offsets[i] = total;
+        total += sizes[i];
+      }
+      return {
+        parts: null,
+        out: new Float32Array(total),
+        offsets,
+        sizes,
+        placed: new Array(count).fill(false),
+      };
+    },
+    add: (state, chunk, index) => {
+      if (state.out !== null && chunk.length === state.sizes[index]) {
+        state.out.set(chunk, state.offsets[index]);
+        state.placed[index] = true;
+        return state;
+      }
+      if (state.out !== null) {
+        //The kernel did not produce the expected size, keep the chunks and join them at the end
+        state.parts = state.placed.map((placed, i) =>
+          placed
+            ? state.out.subarray(state.offsets[i], state.offsets[i] + state.sizes[i])
+            : undefined
+        );
+        state.out = null;
+      }
+      state.parts[index] = chunk.slice();
+      return state;
+    },
+    finalize: (state) => {
+      if (state.out !== null) return state.out;
+      return concatArrays(state.parts.filter((part) => part !== undefined));
+    },
+  },
+
+  /**
+   * Elementwise sum across the outputs of the chunks, e.g. partial accumulators computed per shard.
+   */
+  sum: elementwise((acc, value) => acc + value),
+
+  /**
+   * Elementwise minimum across the outputs of the chunks.
+   */
+  min: elementwise((acc, value) => Math.min(acc, value)),
+
+  /**
+   * Elementwise maximum across the outputs of the chunks.
+   */
+  max: elementwise((acc, value) => Math.max(acc, value)),
+
+  /**
+   * Mergeable summary of every value returned by the chunks. Partial summaries are merged
+   * with the parallel variance update, so the order of arrival does not change the result.
+   * Finalizes into [count, mean, variance, min, max].
+   */
+  summary: {
+    init: () => ({ count: 0, mean: 0, m2: 0, min: Infinity, max: -Infinity }),
+    add: (state, chunk) => mergeSummaries(state, summarize(chunk)),
+    finalize: (state) =>
+      new Float32Array([
+        state.count,
+        state.mean,
+        state.count > 0 ? state.m2 / state.count : 0,
+        state.min,
+        state.max,
+      ]),
+  },
+};
+
+/**
+ * @description Builds an elementwise reducer from a binary operation. Chunks of different lengths are reduced over
+ * the positions they have, so the output is as long as the longest chunk.
+ * @memberof reducers
+ * @param {Function} op - operation combining the accumulated value with the new one
+ * @returns {Object} reducer
+ */
+function elementwise(op) {
+  return {
+    init: () => ({ acc: null }),
+    add: (state, chunk) => {
+      if (state.acc === null) {
+        state.acc = Float64Array.from(chunk);
+        return state;
+      }
+      //Splits leave the last chunk shorter, its missing positions are left out of the reduction
+      if (chunk.length > state.acc.length) {
+        const acc = Float64Array.from(chunk);
+        acc.set(state.acc);
+        [state.acc, chunk] = [acc, chunk.subarray(0, state.acc.length)];
+      }
+      for (let i = 0; i < chunk.length; i++) {
+        state.acc[i] = op(state.acc[i], chunk[i]);
+      }
+      return state;
+    },
+    finalize: (state) =>
+      state.acc === null ? new Float32Array(0) : Float32Array.from(state.acc),
+  };
+}
+
+/**
+ * @description Computes the count, mean, sum of squared deviations, minimum and maximum of a chunk.
+ * @memberof reducers
+ * @param {Float32Array} chunk - values of the chunk
+ * @returns {Object} partial summary
+ */
+export const summarize = (chunk) => {
+  let count = 0,
+    mean = 0,
+    m2 = 0,
+    min = Infinity,
+    max = -Infinity;
+  for (let i = 0; i < chunk.length; i++) {
+    const value = chunk[i];
+    count += 1;
+    const delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+    value < min ? (min = value) : null;
+    value > max ? (max = value) : null;
+  }
+  return { count, mean, m2, min, max };
+};
+
+/**
+ * @description Merges two partial summaries.
+ * @memberof reducers
+ * @param {Object} a - partial summary
+ * @param {Object} b - partial summary
+ * @returns {Object} merged summary
+ */
+export const mergeSummaries = (a, b) => {
+  if (b.count === 0) return a;
+  if (a.count === 0) return { ...b };
+  const count = a.count + b.count,
+    delta = b.mean - a.mean;
+  return {
+    count,
+    mean: a.mean + (delta * b.count) / count,
+    m2: a.m2 + b.m2 + (delta * delta * a.count * b.count) / count,
+    min: Math.min(a.min, b.min),
+    max: Math.max(a.max, b.max),
+  };
+};
+
+/**
+ * @class ResultAssembler
+ * @memberof reducers
+ * @description Reassembles the results of a split run in chunk order. Every chunk is trimmed from
+ * its halo and handed to the reducer when it arrives, so the reduction runs incrementally rather
+ * than after the whole step has finished.
+ * @param {Object} args - assembler arguments
+ * @param {Number} args.count - number of chunks in the run
+ * @param {String|Object} [args.reducer="concat"] - name of a reducer in the reducers namespace or a custom reducer
+ * @param {Array} [args.layout=null] - split layout as given by splits.layout1D
+ * @param {Object} [args.halo=null] - halo used for the split as { left, right, valid }
+ */
+export class ResultAssembler {
+  constructor({ count, reducer = "concat", layout = null, halo = null }) {
+    this.reducer = typeof reducer === "string" ? reducers[reducer] : reducer;
+    if (typeof this.reducer === "undefined" || this.reducer === null) {
+      throw new NotImplemented(`Reducer "${reducer}" is not available.`);
+    }
+    this.count = count;
+    this.layout = layout;
+    this.halo = halo || { left: 0, right: 0, valid: false };
+    this.received = 0;
+    this.state = this.reducer.init({ count, sizes: this.expectedSizes() });
+  }
+
+  /**
+   * @method expectedSizes
+   * @memberof reducers.ResultAssembler
+   * @description Output length expected from each chunk once trimmed, if it can be known from the layout.
+   * @returns {Array|null} sizes per chunk
+   */
+  expectedSizes() {
+    if (this.layout === null) return null;
+    const { left, right, valid } = this.halo;
+    return this.layout.map((chunk) =>
+      valid
+        ? Math.max(0, chunk.end - chunk.start + chunk.left + chunk.right - left - right)
+        : chunk.end - chunk.start
+    );
+  }
+
+  /**
+   * @method add
+   * @memberof reducers.ResultAssembler
+   * @description Adds the output of a chunk to the reduction.
+   * @param {Number} index - index of the chunk in the split
+   * @param {ArrayBuffer|Float32Array} chunk - output of the chunk
+   */
+  add(index, chunk) {
+    let view = chunk instanceof Float32Array ? chunk : new Float32Array(chunk);
+    if (this.layout !== null) {
+      [view] = splits.trimHalos({
+        chunks: [view],
+        layout: [this.layout[index]],
+        valid: this.halo.valid,
+      });
+    }
+    this.state = this.reducer.add(this.state, view, index);
+    this.received += 1;
+  }
+
+  /**
+   * @method result
+   * @memberof reducers.ResultAssembler
+   * @description Finalizes the reduction.
+   * @returns {Float32Array} reduced output
+   */
+  result() {
+    if (this.received !== this.count) {
+      throw new ValueErr(
+        `Only ${this.received} out of ${this.count} chunks have been received.`
+      );
+    }
+    return this.reducer.finalize(this.state);
+  }
+}
@@ -0,0 +1,120 @@
+/**
+ * @namespace runtime
+ * @description Host abstraction for the engines. HydroCompute runs its workers as Web Workers in browsers and as
+ * worker_threads under Node.js, where the same worker scripts are started through a bootstrap that provides the
+ * worker scope (self.onmessage, self.postMessage). Files of the library are read from disk instead of fetched.
+ */
+
+/**
+ * @member isNode
+ * @memberof runtime
+ * @description True when running under Node.js.
+ */
+export const isNode =
+  typeof process !== "undefined" &&
+  typeof process.versions === "object" &&
+  typeof process.versions.node === "string";
+
+/**
+ * @description Synchronous access to a Node.js builtin module.
+ * @memberof runtime
+ * @param {String} name - module name, e.g. "node:os"
+ * @returns {Object|null} module, or null outside of Node.js
+ */
+const builtin = (name) =>
+  isNode && typeof process.getBuiltinModule === "function"
+    ? process.getBuiltinModule(name)
+    : null;
+
+/**
+ * @method workersAvailable
+ * @memberof runtime
+ * @returns {Boolean} true if workers can be created in the current host
+ */
+export const workersAvailable = () =>
+  isNode ? builtin("node:worker_threads") !== null : typeof Worker !== "undefined";
+
+/**
+ * @method hardwareConcurrency
+ * @memberof runtime
+ * @description Number of logical cores available to the process.
+ * @returns {Number} core count
+ */
+export const hardwareConcurrency = () => {
+  const os = builtin("node:os");
+  if (os !== null) {
+    return typeof os.availableParallelism === "function"
+      ? os.availableParallelism()
+      : os.cpus().length;
+  }
+  return typeof navigator !== "undefined" && navigator.hardwareConcurrency
+    ? navigator.hardwareConcurrency
+    : 2;
+};
+
+/**
+ * @class NodeWorker
+ * @memberof runtime
+ * @description Web Worker interface over a worker_threads Worker. Messages and transfer lists are passed through
+ * unchanged, so transferred ArrayBuffers and SharedArrayBuffers behave as they do between browser workers.
+ * @param {URL} url - location of the worker script
+ */
+export class NodeWorker {
+  constructor(url) {
+    const { Worker } = builtin("node:worker_threads");
+    this.onmessage = null;
+    this.onerror = null;
+    this.thread = new Worker(new URL("./node.worker.js", import.meta.url), {
+      workerData: { url: url.href },
+    });
+    this.thread.on("message", (data) => (this.onmessage ? this.onmessage({ data }) : null));
+    this.thread.on("error", (error) => (this.onerror ? this.onerror(error) : null));
+  }
+
+  /**
+   * @method postMessage
+   * @memberof runtime.NodeWorker
+   * @param {*} message - message for the worker
+   * @param {Array} [transfer] - objects transferred to the worker
+   */
+  postMessage(message, transfer) {
+    this.thread.postMessage(message, transfer);
+  }
+
+  /**
+   * @method terminate
+   * @memberof runtime.NodeWorker
+   */
+  terminate() {
+    this.thread.terminate();
+  }
+}
+
+/**
+ * @method createWorker
+ * @memberof runtime
+ * @description Starts a module worker in the current host.
+ * @param {URL} url - location of the worker script
+ * @returns {Worker|NodeWorker} worker
+ */
+export const createWorker = (url) =>
+  isNode ? new NodeWorker(url) : new Worker(url, { type: "module" });
+
+/**
+ * @method readBinary
+ * @memberof runtime
+ * @description Reads a file of the library, from disk for file URLs under Node.js and through fetch otherwise.
+ * @param {URL|String} url - location of the file
+ * @returns {Promise<ArrayBuffer>} file contents
+ */
+export const readBinary = async (url) => {
+  const location = new URL(url, import.meta.url);
+  if (isNode && location.protocol === "file:") {
+    const { readFile } = builtin("node:fs/promises"),
+      file = await readFile(location);
+    return file.buffer.slice(file.byteOffset, file.byteOffset + file.byteLength);
+  }
+  const response = await fetch(location);
+  if (!response.ok) throw new Error(`Could not read ${location.href}: ${response.status}.`);
+  return response.arrayBuffer();
+};
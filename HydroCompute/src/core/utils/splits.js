@@ -1,6 +1,15 @@
 import { ValueErr, NotImplemented } from "./errors.js";
+import { findOperation, operations } from "./costModel.js";
 //Different types of data splits can be added into this section.
 
+/**
+ * @description Checks whether shared memory can be used in the current context.
+ * @returns {boolean} - True if SharedArrayBuffer is available and usable.
+ */
+export const sharedAvailable = () =>
+  typeof SharedArrayBuffer !== "undefined" &&
+  (typeof crossOriginIsolated === "undefined" || crossOriginIsolated);
+
 /**
  * @namespace splits
  * @description Collection of functions to be used for splitting data across HydroCompute
@@ -24,6 +33,117 @@ export const splits = {
     return chunks;
   },
 
+  /**
+   * Computes the layout of a 1D array split into N chunks with halo (overlap) regions.
+   * Halos are clamped at the edges of the array.
+   * @param {object} params - The parameters for the layout.
+   * @param {number} params.length - The length of the 1D array.
+   * @param {number} params.n - The number of chunks to create.
+   * @param {object|number} [params.halo=0] - Halo per chunk as { left, right } or as a symmetric number.
+   * @returns {Array} - Chunk descriptors as { start, end, left, right }, where [start, end) is the
+   * region owned by the chunk and left/right are the halo elements read around it.
+   */
+  layout1D: ({ length: length, n: n, halo: halo = 0 }) => {
+    const { left = 0, right = 0 } =
+      typeof halo === "number" ? { left: halo, right: halo } : halo;
+    const chunkSize = Math.ceil(length / n);
+    const layout = [];
+    for (let i = 0; i < n; i++) {
+      const start = Math.min(i * chunkSize, length),
+        end = Math.min(start + chunkSize, length);
+      layout.push({
+        start,
+        end,
+        left: Math.min(left, start),
+        right: Math.min(right, length - end),
+      });
+    }
+    return layout;
+  },
+
+  /**
+   * Splits a 1D array into N chunks returned as views over the original data (zero-copy),
+   * each extended with its halo region so windowed kernels see their neighbours.
+   * If shared is set and SharedArrayBuffer is available, the data is placed once in shared
+   * memory so that the views can be handed to the workers without any further copies.
+   * @param {object} params - The parameters for splitting the array.
+   * @param {Float32Array} params.data - The 1D array of data.
+   * @param {number} params.n - The number of chunks to create.
+   * @param {object|number} [params.halo=0] - Halo per chunk as { left, right } or as a symmetric number.
+   * @param {boolean} [params.shared=false] - Whether to back the views with a SharedArrayBuffer.
+   * @returns {Array} - An array of Float32Array views, one per chunk.
+   */
+  split1DView: ({ data: data, n: n, halo: halo = 0, shared: shared = false }) => {
+    if (!(data instanceof Float32Array)) {
+      data = new Float32Array(data);
+    }
+    if (
+      shared &&
+      sharedAvailable() &&
+      !(data.buffer instanceof SharedArrayBuffer)
+    ) {
+      const sharedData = new Float32Array(
+        new SharedArrayBuffer(data.byteLength)
+      );
+      sharedData.set(data);
+      data = sharedData;
+    }
+    return splits
+      .layout1D({ length: data.length, n: n, halo: halo })
+      .map(({ start, end, left, right }) =>
+        data.subarray(start - left, end + right)
+      );
+  },
+
+  /**
+   * Removes the halo regions from the results of a split run, in chunk order.
+   * Kernels producing "valid" outputs (e.g. simple moving averages) already consume their
+   * halo and are returned untouched; same-length outputs are trimmed on both sides.
+   * @param {object} params - The parameters for trimming the chunks.
+   * @param {Array} params.chunks - Results per chunk, as ArrayBuffers or Float32Arrays.
+   * @param {Array} params.layout - Layout used for the split, see layout1D.
+   * @param {boolean} [params.valid=false] - Whether the kernel outputs only valid positions.
+   * @returns {Array} - Float32Array views of the trimmed chunks.
+   */
+  trimHalos: ({ chunks: chunks, layout: layout, valid: valid = false }) => {
+    return chunks.map((chunk, i) => {
+      const view = chunk instanceof Float32Array ? chunk : new Float32Array(chunk);
+      if (valid) return view;
+      const { left, right } = layout[i];
+      return view.subarray(left, view.length - right);
+    });
+  },
+
+  /**
+   * Trims the output of a chunk passed through a stage of a pipeline to the values that match a full run,
+   * keeping the halo that the later stages still need. Kernels that return fewer values than they are given
+   * (valid kernels and lagged filters) drop them from the front, shifting the positions of the series they produce.
+   * @param {object} params - The parameters for trimming the chunk.
+   * @param {object} params.chunk - Input of the stage as { from, start, end, length }, where from is the position
+   * of its first value in the series, [start, end) the region owned by the chunk and length that of the series.
+   * @param {number} params.size - The number of values given to the stage.
+   * @param {Float32Array} params.output - The output of the stage for the chunk.
+   * @param {object} params.halo - Halo of the stage as { left, right, valid }, see halos.
+   * @returns {object} - The chunk in the positions of the output series, with a copy of the values kept as data.
+   */
+  trimStage: ({ chunk: chunk, size: size, output: output, halo: halo }) => {
+    const { from, start, end, length } = chunk,
+      drop = size - output.length;
+    //Values computed without the whole halo of the stage differ from a full run, except at the edges of the series
+    const first = halo.valid || from === 0 ? 0 : Math.max(0, halo.left - drop),
+      last =
+        halo.valid || from + size === length
+          ? output.length
+          : Math.max(first, output.length - halo.right);
+    return {
+      data: output.slice(first, last),
+      from: from + first,
+      start: Math.max(0, start - drop),
+      end: end - drop,
+      length: length - drop,
+    };
+  },
+
   /**
    * Splits each array from a 2D matrix into N different chunks.
    * @param {object} params - The parameters for splitting the matrix.
@@ -112,3 +232,74 @@ export const splits = {
     }
   },
 };
+
+//Float32 resolution used to bound the memory of recursive (IIR) filters
+const FLOAT_EPS = Math.pow(2, -24);
+
+/**
+ * @description Number of past samples after which a recursive filter with the given decay
+ * no longer changes a float32 result.
+ * @param {number} decay - Weight kept from the previous output at each step, in (0, 1).
+ * @returns {number} - Number of samples required as halo.
+ */
+const iirHalo = (decay) =>
+  decay <= 0 ? 0 : Math.ceil(Math.log(FLOAT_EPS) / Math.log(decay));
+
+/**
+ * @namespace halos
+ * @description Halo (overlap) required per kernel when its input is split across workers.
+ * Each entry receives the additional arguments of the function and returns { left, right, valid },
+ * where valid marks kernels whose output already excludes the halo positions. Kernels that are not
+ * listed are split plainly, with no halo, and those whose operation is not chunkable in the cost
+ * model cannot be split. New kernels can be added with halos.register.
+ */
+export const halos = {
+  simpleMovingAverage_js: ([window = 5] = []) => ({ left: window - 1, right: 0, valid: true }),
+  //The AssemblyScript average returns zeros in place of the first window - 1 values
+  simpleMovingAverage: ([window = 5] = []) => ({ left: window - 1, right: 0 }),
+  expoMovingAverage_js: ([alpha = 0.5] = []) => ({ left: iirHalo(1 - alpha), right: 0 }),
+  exponentialMovingAverage: ([alpha = 0.5] = []) => ({ left: iirHalo(1 - alpha), right: 0 }),
+  dspItrend_js: ([period = 7] = []) => ({ left: period + iirHalo(1 - 2 / (period + 1)), right: 0 }),
+  dispItrend: ([period = 7] = []) => ({ left: period + iirHalo(1 - 2 / (period + 1)), right: 0 }),
+  linearWeightedAverage_js: ([windowSize = 2] = []) => ({ left: windowSize, right: windowSize }),
+  linearWeightedAverage: ([windowSize = 2] = []) => ({ left: windowSize, right: windowSize }),
+  noiseSmoother_js: ([windowSize = 1] = []) => ({ left: windowSize, right: windowSize }),
+  _boxcox_transform: () => ({ left: 0, right: 0, valid: true }),
+
+  /**
+   * Registers or replaces the halo of a kernel.
+   * @param {string} name - The name of the function.
+   * @param {object|function} spec - { left, right, valid } or a function of the additional arguments returning it.
+   */
+  register: (name, spec) => {
+    halos[name] = typeof spec === "function" ? spec : () => spec;
+  },
+
+  /**
+   * Resolves the halo to use for a set of functions run over the same split, taking the largest extent.
+   * @param {Array} functions - Names of the functions in the split.
+   * @param {Array} [funcArgs=[]] - Additional arguments per function.
+   * @returns {object} - { left, right, valid }
+   * @throws {ValueErr} - If the operation of any of the functions is not chunkable.
+   */
+  resolve: (functions, funcArgs = []) => {
+    let halo = { left: 0, right: 0, valid: true };
+    functions.forEach((name, i) => {
+      const op = findOperation(name);
+      if (op !== null && !operations[op].chunkable) {
+        throw new ValueErr(`${name} cannot be split: its operation is not chunkable in the cost model.`);
+      }
+      //Kernels without a registered halo are split plainly
+      const spec =
+        typeof halos[name] === "function" && !["register", "resolve"].includes(name)
+          ? halos[name](Array.isArray(funcArgs[i]) ? funcArgs[i] : [])
+          : { left: 0, right: 0, valid: false };
+      halo = {
+        left: Math.max(halo.left, spec.left || 0),
+        right: Math.max(halo.right, spec.right || 0),
+        valid: halo.valid && spec.valid === true,
+      };
+    });
+    return halo;
+  },
+};
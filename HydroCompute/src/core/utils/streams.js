@@ -0,0 +1,105 @@
+/**
+ * @namespace streams
+ * @description Bounded queues used to stream chunks of data between the stages of a pipelined run.
+ */
+
+/**
+ * @class ChunkQueue
+ * @memberof streams
+ * @description Bounded asynchronous FIFO queue with backpressure. Producers awaiting `push` are held
+ * while the queue is full, and consumers awaiting `pull` are held while it is empty. Closing the queue
+ * drains the remaining items and then signals the end of the stream to the consumers.
+ * @param {Number} [capacity=2] - maximum number of chunks held by the queue at any time.
+ * @example
+ * const q = new ChunkQueue(4);
+ * await q.push({ index: 0, data: chunk });
+ * q.close();
+ * for await (const item of q) {...}
+ */
+export class ChunkQueue {
+  constructor(capacity = 2) {
+    this.capacity = Math.max(1, capacity);
+    this.items = [];
+    this.closed = false;
+    this.error = null;
+    this.waitingPush = [];
+    this.waitingPull = [];
+    //Maximum number of items resident at once, useful to verify the memory bound of a run
+    this.highWaterMark = 0;
+  }
+
+  /**
+   * @method push
+   * @memberof streams.ChunkQueue
+   * @description Adds an item to the queue, waiting while the queue is at capacity.
+   * @param {*} item - chunk to be added
+   * @returns {Promise<void>} resolves once the item has been enqueued.
+   */
+  async push(item) {
+    while (this.items.length >= this.capacity && this.error === null) {
+      await new Promise((resolve) => this.waitingPush.push(resolve));
+    }
+    if (this.error !== null) throw this.error;
+    if (this.closed) throw new Error("Cannot push into a closed queue.");
+    this.items.push(item);
+    this.highWaterMark = Math.max(this.highWaterMark, this.items.length);
+    this.waitingPull.length > 0 ? this.waitingPull.shift()() : null;
+  }
+
+  /**
+   * @method pull
+   * @memberof streams.ChunkQueue
+   * @description Removes the oldest item from the queue, waiting while the queue is empty.
+   * @returns {Promise<Object>} iterator-like result `{ value, done }`. `done` is true once the queue is closed and drained.
+   */
+  async pull() {
+    while (this.items.length === 0 && !this.closed && this.error === null) {
+      await new Promise((resolve) => this.waitingPull.push(resolve));
+    }
+    if (this.error !== null) throw this.error;
+    if (this.items.length === 0) return { value: undefined, done: true };
+    const value = this.items.shift();
+    this.waitingPush.length > 0 ? this.waitingPush.shift()() : null;
+    return { value, done: false };
+  }
+
+  /**
+   * @method close
+   * @memberof streams.ChunkQueue
+   * @description Marks the end of the stream. Pending consumers are released once the queue is drained.
+   */
+  close() {
+    this.closed = true;
+    this.wakeAll();
+  }
+
+  /**
+   * @method abort
+   * @memberof streams.ChunkQueue
+   * @description Fails the queue, rejecting every pending and future push or pull with the given error.
+   * @param {Error} error - error propagated to producers and consumers
+   */
+  abort(error) {
+    this.error = error;
+    this.items = [];
+    this.wakeAll();
+  }
+
+  /**
+   * @method wakeAll
+   * @memberof streams.ChunkQueue
+   * @description Releases every producer and consumer waiting on the queue so they re-check its state.
+   */
+  wakeAll() {
+    for (const resolve of this.waitingPull.splice(0)) resolve();
+    for (const resolve of this.waitingPush.splice(0)) resolve();
+  }
+
+  async *[Symbol.asyncIterator]() {
+    while (true) {
+      const { value, done } = await this.pull();
+      if (done) return;
+      yield value;
+    }
+  }
+}
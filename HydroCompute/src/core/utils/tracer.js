@@ -0,0 +1,186 @@
+import { isNode } from "./runtime.js";
+import { wallClock } from "./globalUtils.js";
+
+/**
+ * @namespace tracer
+ * @description Timeline of the runs as Chrome trace events, to be opened in Perfetto (ui.perfetto.dev) or
+ * chrome://tracing. Each worker task is drawn on the lane of its worker, as the spans spawn, module load, marshal-in,
+ * kernel and marshal-out, with the time it waited before being spawned as an async queue slice. Posting the messages
+ * and reassembling the results are drawn on the main thread. Every span is tagged with the step, function and worker
+ * of its task, so stalls and idle workers show up as gaps between the spans.
+ */
+
+/**
+ * @description Spans of a worker task, in order, as the pairs of timeline fields they run between.
+ * @memberof tracer
+ */
+const taskSpans = [
+  ["spawn", "spawned", "startScript"],
+  ["module load", "startScript", "loadedScript"],
+  ["marshal-in", "loadedScript", "startFunction"],
+  ["kernel", "startFunction", "endFunction"],
+  ["marshal-out", "endFunction", "received"],
+];
+
+/**
+ * @class Tracer
+ * @memberof tracer
+ * @description Collects the trace events of the runs of one or more engines.
+ * @param {Object} [options] - tracer options
+ * @param {Number} [options.capacity=1000000] - maximum events kept. Later events are dropped and counted.
+ */
+export class Tracer {
+  constructor({ capacity = 1000000 } = {}) {
+    this.capacity = capacity;
+    this.origin = wallClock();
+    this.events = [];
+    this.dropped = 0;
+    this.tasks = 0;
+    //Process ids per engine, thread ids per worker lane
+    this.processes = new Map();
+    this.lanes = new Set();
+  }
+
+  /**
+   * @method push
+   * @memberof tracer.Tracer
+   * @param {Object} event - trace event
+   */
+  push(event) {
+    this.events.length < this.capacity ? this.events.push(event) : (this.dropped += 1);
+  }
+
+  /**
+   * @method pid
+   * @memberof tracer.Tracer
+   * @param {String} engine - engine name
+   * @returns {Number} process id of the engine in the trace
+   */
+  pid(engine) {
+    if (!this.processes.has(engine)) this.processes.set(engine, this.processes.size + 1);
+    return this.processes.get(engine);
+  }
+
+  /**
+   * @method ts
+   * @memberof tracer.Tracer
+   * @param {Number} time - wall clock time in ms
+   * @returns {Number} trace timestamp in µs from the creation of the tracer
+   */
+  ts(time) {
+    return (time - this.origin) * 1000;
+  }
+
+  /**
+   * @method span
+   * @memberof tracer.Tracer
+   * @description Adds a span of the main thread.
+   * @param {String} engine - engine name
+   * @param {String} name - span name
+   * @param {Number} start - wall clock start in ms
+   * @param {Number} end - wall clock end in ms
+   * @param {Object} [args] - tags of the span, e.g. step and function
+   */
+  span(engine, name, start, end, args = {}) {
+    this.push({
+      name,
+      cat: "main",
+      ph: "X",
+      ts: this.ts(start),
+      dur: Math.max(0, end - start) * 1000,
+      pid: this.pid(engine),
+      tid: 0,
+      args,
+    });
+  }
+
+  /**
+   * @method task
+   * @memberof tracer.Tracer
+   * @description Adds the spans of a worker task from the timeline recorded by the thread manager.
+   * @param {String} engine - engine name
+   * @param {Object} timing - timeline of the task, see threadManager.timings
+   */
+  task(engine, timing) {
+    const pid = this.pid(engine),
+      tid = Number(timing.id) + 1,
+      args = { step: timing.step, funcName: timing.funcName, worker: Number(timing.id), task: this.tasks++ };
+    this.lanes.add(`${pid}:${tid}`);
+    if (typeof timing.queued === "number" && timing.spawned > timing.queued) {
+      const id = `${pid}-${args.task}`;
+      this.push({ name: "queue", cat: "queue", ph: "b", id, ts: this.ts(timing.queued), pid, tid, args });
+      this.push({ name: "queue", cat: "queue", ph: "e", id, ts: this.ts(timing.spawned), pid, tid, args });
+    }
+    this.span(engine, "post", timing.created, timing.posted, args);
+    //Clocks of the workers are aligned with the main thread through the epoch, spans are kept from overlapping
+    let last = timing.spawned;
+    for (const [name, from, to] of taskSpans) {
+      if (typeof timing[from] !== "number" || typeof timing[to] !== "number") continue;
+      const start = Math.max(last, timing[from]),
+        end = Math.max(start, timing[to]);
+      this.push({
+        name,
+        cat: name === "kernel" ? "kernel" : "worker",
+        ph: "X",
+        ts: this.ts(start),
+        dur: (end - start) * 1000,
+        pid,
+        tid,
+        args,
+      });
+      last = end;
+    }
+  }
+
+  /**
+   * @method toJSON
+   * @memberof tracer.Tracer
+   * @returns {Object} trace in the Chrome trace event format
+   */
+  toJSON() {
+    const metadata = [];
+    for (const [engine, pid] of this.processes) {
+      metadata.push({ name: "process_name", ph: "M", pid, tid: 0, args: { name: `hydrocompute ${engine}` } });
+      metadata.push({ name: "thread_name", ph: "M", pid, tid: 0, args: { name: "main" } });
+    }
+    for (const lane of this.lanes) {
+      const [pid, tid] = lane.split(":").map(Number);
+      metadata.push({ name: "thread_name", ph: "M", pid, tid, args: { name: `worker ${tid - 1}` } });
+      metadata.push({ name: "thread_sort_index", ph: "M", pid, tid, args: { sort_index: tid } });
+    }
+    return {
+      traceEvents: [...metadata, ...this.events],
+      displayTimeUnit: "ms",
+      otherData: { origin: new Date(this.origin).toISOString(), dropped: this.dropped },
+    };
+  }
+
+  /**
+   * @method save
+   * @memberof tracer.Tracer
+   * @description Writes the trace into a file under Node.js, or downloads it in browsers.
+   * @param {String} [path="hydrocompute-trace.json"] - file path, or name of the download
+   * @returns {Promise<void>}
+   */
+  async save(path = "hydrocompute-trace.json") {
+    const json = JSON.stringify(this.toJSON());
+    if (isNode) {
+      const { writeFile } = await import("node:fs/promises");
+      return writeFile(path, json);
+    }
+    const url = URL.createObjectURL(new Blob([json], { type: "application/json" })),
+      link = Object.assign(document.createElement("a"), { href: url, download: path });
+    link.click();
+    URL.revokeObjectURL(url);
+  }
+
+  /**
+   * @method clear
+   * @memberof tracer.Tracer
+   * @description Removes the events collected so far.
+   */
+  clear() {
+    this.events = [];
+    this.dropped = 0;
+  }
+}
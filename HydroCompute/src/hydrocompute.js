@@ -1,7 +1,13 @@
 import { kernels } from "./core/kernels.js";
-import { splits } from "./core/utils/splits.js";
+import { splits, halos } from "./core/utils/splits.js";
 import { dataCloner, importJSONdata } from "./core/utils/globalUtils.js";
 import engine from "./core/mainEngine.js";
+import autoEngine from "./core/autoEngine.js";
+import { ResultMemo } from "./core/utils/memoize.js";
+import { Tracer } from "./core/utils/tracer.js";
+import { Metrics } from "./core/utils/metrics.js";
+import * as outOfCore from "./core/utils/outOfCore.js";
+import { removeTemporaryStores } from "./core/utils/memory.js";
 import webrtc from "./webrtc/webrtc.js";
 
 /**
@@ -19,6 +25,9 @@ class hydroCompute {
     this.currentEngine;
     this.currentEngineName = null;
     this.instanceRun = 0;
+    this.memo = null;
+    this.tracer = null;
+    this.metrics = null;
 
     this.availableData = [];
     this.engineResults = {};
@@ -119,6 +128,9 @@ class hydroCompute {
           kernels[this.currentEngineName]
         );
       }
+    } else if (this.currentEngineName === "auto") {
+      //Routes every call to the fastest implementation measured by the cost model
+      this.currentEngine = new autoEngine();
     } else {
       this.currentEngineName === "webrtc"
         ? (this.currentEngine = new webrtc())
@@ -128,6 +140,11 @@ class hydroCompute {
           ));
     }
 
+    //The memo is shared by every engine, keys include the engine name
+    this.currentEngine.memo = this.memo;
+    this.currentEngine.tracer = this.tracer;
+    this.currentEngine.metrics = this.metrics;
+
     if (Object.keys(this.calledEngines).includes(kernel)) {
       this.calledEngines[kernel] += 1;
     } else {
@@ -135,6 +152,27 @@ class hydroCompute {
     }
   }
 
+  /**
+   * @description Benchmarks the implementations of each operation across the available engines and stores the
+   * resulting cost model. The model is used by the "auto" engine, which is set if it is not the current one.
+   * @memberof hydroCompute
+   * @param {Object} [args] - calibration arguments
+   * @param {Array} [args.sizes] - input sizes to benchmark
+   * @param {Number} [args.repeats] - repetitions per size
+   * @param {Array} [args.ops] - operations to calibrate
+   * @returns {Promise<Object>} measured cost model
+   * @example
+   * await compute.calibrate({ sizes: [1000, 100000] });
+   * await compute.run({ functions: ['simpleMovingAverage'], dataIds: ['id1'] });
+   */
+  async calibrate(args = {}) {
+    if (this.currentEngineName !== "auto") {
+      await this.setEngine("auto");
+    }
+    let model = await this.currentEngine.calibrate(args);
+    return model.toJSON();
+  }
+
   /**
    * @description Runs the specified functions with the given arguments using the current engine. The engine must be set previous to the run function to be called.
    * @memberof hydroCompute
@@ -145,6 +183,10 @@ class hydroCompute {
    * @param {Array} [args.dependencies=[]] - An array specifying the dependencies between functions.
    * @param {Array} [args.scriptName=[]] - An array of script names.
    * @param {Array} [args.dataSplits=[]] - An array specifying if data should be split for each function.
+   * @param {String|Object} [args.reduce="concat"] - Reducer used to reassemble split steps: concat, sum, min, max, summary or a custom { init, add, finalize } object.
+   * @param {Boolean} [args.incremental=false] - Keeps the state of resumable functions per data id, so that values added with append update the results without a full recompute.
+   * @param {*} [args.seed=null] - Seed of the run. Memoized results of the kernels drawing from it are only reused for the same seed.
+   * @param {Boolean|Object} [args.pipeline=false] - Streams chunks through linked steps or chained functions instead of running them as full barriers. Pass { chunks, capacity } to tune the chunking.
    * @returns {Promise<void>} - A Promise that resolves once the functions are executed.
    * @example
    * //Case 1: Running a script in home folder with 'main' function steering the script and a single data instance saved on 'availableData'
@@ -153,6 +195,8 @@ class hydroCompute {
    * await compute.run({functions: ['f1', 'f2', 'f3'], dataIds: ['id1', 'id2', 'id3']})
    * //Case 3: Linking steps and linking functions within steps
    * await compute.run({functions: [['f1', 'f2'], ['f3']],, dependencies:[[[], [0]], []] dataIds: ['id1', 'id2', 'id3']})
+   * //Case 4: Streaming a chain of chunkable functions with chunk-level dataflow
+   * await compute.run({functions: ['f1', 'f2'], dependencies: true, pipeline: { chunks: 16 }, dataIds: ['id1']})
    */
   async run(
     //CASE 1: functions running on "main" or "_mainFunction" saved on local dev and passing a string
@@ -271,6 +315,11 @@ class hydroCompute {
           funcArgs,
           dependencies,
           linked: args.linked || false,
+          pipeline: args.pipeline || false,
+          reduce: args.reduce || "concat",
+          seed: typeof args.seed !== "undefined" ? args.seed : null,
+          incremental: args.incremental || false,
+          sessions: dataIds,
         });
         //functions = Array.from({length: dataIds.length}, (_, i) => functions)
         //Await for results from the engine to finish
@@ -384,6 +433,211 @@ class hydroCompute {
     }
   }
 
+  /**
+   * Appends values at the tail of a stored series. Series run with `incremental: true` have their resumable
+   * functions updated from the new values only, and the updated outputs are saved as a new simulation result.
+   * Outputs of streaming functions (moving averages, detrend) cover the appended values, while reductions return
+   * their updated value over the whole series.
+   * @memberof hydroCompute
+   * @param {string} id - The ID of the data container.
+   * @param {Array|Float32Array} values - The appended values.
+   * @returns {boolean} true if the results were updated incrementally, false if a new run is required.
+   * @example
+   * await compute.run({ functions: ['simpleMovingAverage_js', 'summary'], dataIds: ['flow'], incremental: true })
+   * compute.append('flow', latestReadings)
+   */
+  append(id, values) {
+    const container = this.availableData.find((item) => item.id === id);
+    if (typeof container === "undefined" || !(container.data instanceof Float32Array)) {
+      console.error(`Series with nametag: "${id}" not found in the storage.`);
+      return false;
+    }
+    //The series grows within a buffer of doubling capacity, so appends stay proportional to the chunk
+    const chunk = values instanceof Float32Array ? values : Float32Array.from(values),
+      size = container.data.length + chunk.length;
+    if (
+      container.data.byteOffset !== 0 ||
+      size > container.data.buffer.byteLength / Float32Array.BYTES_PER_ELEMENT
+    ) {
+      const grown = new Float32Array(Math.max(size, 2 * container.data.length));
+      grown.set(container.data);
+      container.data = grown.subarray(0, container.data.length);
+    }
+    container.data = new Float32Array(container.data.buffer, 0, size);
+    container.data.set(chunk, size - chunk.length);
+
+    if (
+      typeof this.currentEngine.append !== "function" ||
+      !this.currentEngine.append({ session: id, data: chunk })
+    ) {
+      return false;
+    }
+    this.instanceRun += 1;
+    this.setResults([id]);
+    return true;
+  }
+
+  /**
+   * Runs functions over a series or a pair of matrices that does not fit in memory. The data is read in windows from
+   * a local file (Node) or a Blob/File (browsers) of little endian float32 values, and each window is run on the current
+   * engine through its chunkable kernels (Box-Cox, moving averages) or a blocked matrix product over tiles, while the
+   * reductions resume from a window to the next. Outputs with one value per input are written window by window into
+   * files (Node) or Blobs, and kept in the results as spilled results, loaded with restoreResults.
+   * @memberof hydroCompute
+   * @param {Object} args - run arguments
+   * @param {string|Blob} args.source - location of the file, or the Blob/File holding the data
+   * @param {Array} args.functions - functions to run, or a single matrix product over two square matrices
+   * @param {Array} [args.funcArgs] - arguments of each function
+   * @param {number} [args.windowSize] - values read at a time
+   * @param {string} [args.output] - directory of the outputs under Node. Defaults to a temporary directory.
+   * @param {string} [args.id] - name of the results. Defaults to the name of the source.
+   * @returns {Promise<void>} - A Promise that resolves once the whole source has been processed.
+   * @example
+   * await compute.runOutOfCore({ source: 'gauges/05454500.f32', functions: ['summary', 'simpleMovingAverage_js'] })
+   */
+  async runOutOfCore({ id, ...args }) {
+    const name =
+      typeof id !== "undefined"
+        ? id
+        : typeof args.source === "string"
+        ? args.source.split(/[\\/]/).pop().replace(/\.[^.]*$/, "")
+        : this.makeId(5);
+    try {
+      const result = await outOfCore.run({ ...args, engine: this.currentEngine, name });
+      this.currentEngine.results.push(result);
+      this.instanceRun += 1;
+      this.setResults([name]);
+    } catch (error) {
+      console.error(`Out-of-core run over ${name} could not be completed.`, error);
+      throw error;
+    }
+  }
+
+  /**
+   * Enables the memoization of kernel results across runs. Every task is keyed by its engine, function and the hash of the
+   * module, addon or script it runs from, the hash of its input, its number of series, its arguments and, for the kernels
+   * drawing from it, the seed of the run, and identical tasks are served from an in-memory LRU or from a persistent local
+   * store (IndexedDB or files under Node) instead of running again.
+   * @memberof hydroCompute
+   * @param {Object|Boolean} [options] - memo options, or false to disable the memo
+   * @param {number} [options.capacity] - bytes kept in memory
+   * @param {boolean} [options.persistent=true] - whether results are kept in the local store across sessions
+   * @param {string} [options.directory] - directory of the local store under Node
+   * @param {number} [options.storeCapacity] - bytes kept in the local store under Node, least recently used removed first
+   * @param {number} [options.maxAge] - ms after which results are removed from the local store under Node
+   * @returns {Object|null} the memo, exposing its hits and misses
+   * @example
+   * compute.memoize({ capacity: 128 * 1024 ** 2 })
+   * await compute.run({ functions: ['simpleMovingAverage'], dataIds: ['id1'] }) // computed
+   * await compute.run({ functions: ['simpleMovingAverage'], dataIds: ['id1'] }) // served from the memo
+   */
+  memoize(options = {}) {
+    this.memo = options === false ? null : new ResultMemo(options);
+    if (typeof this.currentEngine !== "undefined") {
+      this.currentEngine.memo = this.memo;
+    }
+    return this.memo;
+  }
+
+  /**
+   * Records the timeline of the following runs as Chrome trace events. Every worker task is drawn with its queueing,
+   * spawn, module load, marshalling and kernel spans on the lane of its worker, and the reassembly of the results on
+   * the main thread. The trace opens in Perfetto (ui.perfetto.dev) or chrome://tracing.
+   * @memberof hydroCompute
+   * @param {Object|Boolean} [options] - tracer options, or false to stop tracing
+   * @param {number} [options.capacity] - maximum events kept
+   * @returns {Object|null} the tracer, exposing toJSON() and save(path)
+   * @example
+   * const tracer = compute.trace()
+   * await compute.run({ functions: ['_boxcox_transform', '_boxcox_transform'], dataIds: ['id1'], dataSplits: [true] })
+   * await tracer.save('run.trace.json')
+   */
+  trace(options = {}) {
+    this.tracer = options === false ? null : new Tracer(options);
+    if (typeof this.currentEngine !== "undefined") {
+      this.currentEngine.tracer = this.tracer;
+    }
+    return this.tracer;
+  }
+
+  /**
+   * Records counters, histograms and gauges of the following runs: tasks, bytes transferred and allocations, kernel
+   * latency per function and queue wait, busy workers and heap size, and the iterations and convergence reported by
+   * the C kernels. Nothing is recorded unless enabled.
+   * @memberof hydroCompute
+   * @param {Boolean} [enabled=true] - false to stop recording
+   * @returns {Object|null} the metrics registry, exposing snapshot() and reset()
+   * @example
+   * compute.collectMetrics()
+   * await compute.run({ functions: ['_arima_autoParams'], dataIds: ['id1'] })
+   * compute.getMetrics().histograms['latency._arima_autoParams'].p90
+   */
+  collectMetrics(enabled = true) {
+    this.metrics = enabled === false ? null : new Metrics();
+    if (typeof this.currentEngine !== "undefined") {
+      this.currentEngine.metrics = this.metrics;
+    }
+    return this.metrics;
+  }
+
+  /**
+   * Returns the metrics recorded since they were enabled or last reset.
+   * @memberof hydroCompute
+   * @returns {Object|null} counters, histogram summaries (count, sum, min, max, mean, p50, p90, p99) and gauges
+   * (value, max) keyed by name, or null if metrics are not collected
+   */
+  getMetrics() {
+    return this.metrics !== null ? this.metrics.snapshot() : null;
+  }
+
+  /**
+   * Sets the memory budget of the current engine. Tasks are admitted while their estimated working set fits in
+   * the budget, and retained results are spilled into a local store (IndexedDB or files under Node) when needed.
+   * @memberof hydroCompute
+   * @param {number} bytes - budget in bytes. Infinity removes the limit.
+   * @example
+   * compute.setMemoryBudget(512 * 1024 ** 2)
+   */
+  setMemoryBudget(bytes) {
+    if (typeof this.currentEngine.memory === "undefined") {
+      return console.error("The current engine does not support memory budgets.");
+    }
+    this.currentEngine.memory.limit = bytes;
+  }
+
+  /**
+   * Sets the maximum number of workers the current engine runs at the same time. By default, all the available
+   * cores but one are used. Tasks beyond the limit wait for a later batch.
+   * @memberof hydroCompute
+   * @param {number|null} count - maximum number of workers, or null to restore the default.
+   * @example
+   * compute.setMaxWorkers(4)
+   */
+  setMaxWorkers(count) {
+    if (typeof this.currentEngine.threads === "undefined") {
+      return console.error("The current engine does not run on workers.");
+    }
+    this.currentEngine.threads.setWorkerLimit(count);
+  }
+
+  /**
+   * Loads back into memory the results of a simulation that were spilled to the local store.
+   * @memberof hydroCompute
+   * @param {string} name - The name of the simulation.
+   * @returns {Promise<void>} - A Promise that resolves once every result is in memory.
+   */
+  async restoreResults(name) {
+    for (let resultName in this.engineResults[name]) {
+      let stgResults = this.engineResults[name][resultName].results;
+      if (!Array.isArray(stgResults)) continue;
+      for (let k = 0; k < stgResults.length; k++) {
+        if (stgResults[k] && stgResults[k].spilled) {
+          stgResults[k] = await stgResults[k].load();
+        }
+      }
+    }
+  }
+
   /**
    * Retrieves the results for a specific simulation by name.
    * @memberof hydroCompute
@@ -411,6 +665,12 @@ class hydroCompute {
         ) {
           let stgRes = this.engineResults[name][resultName].results[k];
           let stgFunc = this.engineResults[name][resultName].funcOrder[k];
+          if (stgRes.spilled) {
+            console.warn(
+              `Result of ${stgFunc} is spilled. Call restoreResults("${name}") first.`
+            );
+            continue;
+          }
           //for (let result in this.engineResults[name][resultName][stgRes].results) {
           if (stgRes.byteLength !== 0) {
             x.push(Array.from(new Float32Array(stgRes)));
@@ -468,6 +728,20 @@ class hydroCompute {
     return r;
   }
 
+  /**
+   * Sets the halo (overlap) a kernel needs at the edges of its chunks when its data is split across workers.
+   * Kernels without a registered halo are split plainly, and those marked as not chunkable in the cost model are not
+   * split at all.
+   * @memberof hydroCompute
+   * @param {string} name - The name of the function.
+   * @param {Object|Function} spec - { left, right, valid } or a function of the additional arguments returning it.
+   * @example
+   * compute.setHalo('myFilter', { left: 10, right: 10 })
+   */
+  setHalo(name, spec) {
+    halos.register(name, spec);
+  }
+
   /**
    * Generates a random ID string.
    * @memberof hydroCompute
@@ -513,6 +787,19 @@ class hydroCompute {
     return [fnTotal, scrTotal];
   }
 
+  /**
+   * Clears the stored data and results, and removes the temporary files of the spilled and out-of-core results.
+   * Temporary files are also removed when the process exits.
+   * @memberof hydroCompute
+   * @returns {Promise<void>}
+   */
+  async reset() {
+    this.availableData = [];
+    this.engineResults = {};
+    this.instanceRun = 0;
+    await removeTemporaryStores();
+  }
+
   /**
    * Retrieves the available results stored in the `engineResults` object.
    * @memberof hydroCompute
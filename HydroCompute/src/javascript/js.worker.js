@@ -10,8 +10,8 @@ self.onmessage = async (e) => {
   performance.mark("start-script");
   const { funcName, id, step, scriptName } = e.data;
 
-  // Convert the incoming data into a Float32Array
-  let data = new Float32Array(e.data.data);
+  // Convert the incoming data into a Float32Array. Shared inputs are read in place from their offset.
+  let data = new Float32Array(e.data.data, e.data.byteOffset || 0, e.data.elementCount);
 
   // Load the script file dynamically
   let scripts;
@@ -22,6 +22,7 @@ self.onmessage = async (e) => {
   } else {
     scripts = await import("./scripts/scripts.js");
   }
+  performance.mark("loaded-script");
   
   let result = null;
 
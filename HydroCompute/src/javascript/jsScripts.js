@@ -1,4 +1,5 @@
 import * as scripts from './scripts/scripts.js'
+import { hashFiles } from "../core/utils/memoize.js";
 
 /**
  * Retrieves the JavaScript scripts and their associated functions.
@@ -21,4 +22,16 @@ export const jsScripts = () => {
       fun.set(func, fn)
     }
     return fun;
-}
\ No newline at end of file
+}
+
+/**
+ * Version of the kernels of the engine, the hash of the script files holding them.
+ * @memberof jsScripts
+ * @member jsVersion
+ * @returns {Promise<string>} - The hash of the scripts.
+ */
+export const jsVersion = () =>
+  hashFiles([
+    new URL("./scripts/matrixUtils_js.js", import.meta.url),
+    new URL("./scripts/timeSeries_js.js", import.meta.url),
+  ]);
@@ -0,0 +1,312 @@
+/**
+ * @brief Node.js addon exposing the native kernels to the native engine of HydroCompute.
+ *
+ * Kernels read from and write into the backing stores of the Float32Arrays passed by the caller, so no data is
+ * copied between JavaScript and C. Asynchronous runs execute on the libuv threadpool and resolve a promise on the
+ * main thread once the kernel finishes. The arrays are referenced until then and must not be transferred or
+ * written from JavaScript while the kernel runs.
+ *
+ *   run(name, input[, output][, {threads, block}])     -> Promise<Float32Array>
+ *   runSync(name, input[, output][, {threads, block}]) -> Float32Array
+ *   kernels()                                           -> Array of kernel names
+ *
+ * threads is the number of OpenMP threads of the kernel, all the processors of the host by default. Callers running
+ * several kernels at once should pass 1 so the runs do not oversubscribe the cores.
+ *
+ * The result carries the execution time of the kernel in milliseconds in its elapsed property, and the statistics of
+ * the call (see hc_stats) in its status, statusDetail, iterations and converged properties. Its memory property holds
+ * the allocations, bytes and peak live bytes of the scratch memory of the kernel (see hc_memory_stats).
+ */
+#define NAPI_VERSION 6
+#include <node_api.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "hc_registry.h"
+
+#define NAPI_CALL(env, call)                                                   \
+    do {                                                                       \
+        if ((call) != napi_ok) {                                               \
+            const napi_extended_error_info* info = NULL;                       \
+            napi_get_last_error_info((env), &info);                            \
+            bool pending = false;                                              \
+            napi_is_exception_pending((env), &pending);                        \
+            if (!pending) {                                                    \
+                napi_throw_error((env), NULL,                                  \
+                    info && info->error_message ? info->error_message          \
+                                                : "Native addon call failed"); \
+            }                                                                  \
+            return NULL;                                                       \
+        }                                                                      \
+    } while (0)
+
+/**
+ * @brief Kernel call prepared on the main thread.
+ */
+typedef struct {
+    const hc_kernel_entry* kernel;
+    float* data;
+    float* result;
+    size_t length;
+    int block;
+    int threads;
+    double elapsed;
+    hc_stats stats;
+    hc_memory_stats memory;
+    napi_ref input;
+    napi_ref output;
+    napi_deferred deferred;
+    napi_async_work work;
+} hc_call;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void execute_call(hc_call* call) {
+#ifdef _OPENMP
+    //Threads of the pool keep the count of the last call they ran, so it is set on every call
+    omp_set_num_threads(call->threads > 0 ? call->threads : omp_get_num_procs());
+#endif
+    hc_reset_stats();
+    hc_memory_reset();
+    double start = now_ms();
+    hc_run_kernel(call->kernel, call->data, call->result, call->length, call->block);
+    call->elapsed = now_ms() - start;
+    call->stats = *hc_last_stats();
+    call->memory = *hc_last_memory();
+}
+
+/**
+ * @brief Reads a Float32Array argument.
+ *
+ * @return 1 if value is a Float32Array, 0 otherwise.
+ */
+static int float32_array(napi_env env, napi_value value, float** data, size_t* length) {
+    bool isTyped = false;
+    napi_typedarray_type type;
+    void* ptr = NULL;
+    if (napi_is_typedarray(env, value, &isTyped) != napi_ok || !isTyped) return 0;
+    if (napi_get_typedarray_info(env, value, &type, length, &ptr, NULL, NULL) != napi_ok) return 0;
+    if (type != napi_float32_array) return 0;
+    *data = ptr;
+    return 1;
+}
+
+static int int_option(napi_env env, napi_value options, const char* key, int fallback) {
+    bool has = false;
+    napi_value value;
+    int32_t result;
+    if (napi_has_named_property(env, options, key, &has) != napi_ok || !has) return fallback;
+    if (napi_get_named_property(env, options, key, &value) != napi_ok) return fallback;
+    return napi_get_value_int32(env, value, &result) == napi_ok ? result : fallback;
+}
+
+/**
+ * @brief Validates the arguments of run and runSync and prepares the call, allocating the output if none is given.
+ *
+ * @return The output array, or NULL with a pending exception.
+ */
+static napi_value prepare_call(napi_env env, napi_callback_info info, hc_call* call) {
+    size_t argc = 4;
+    napi_value argv[4], output = NULL, options = NULL;
+    char name[64];
+    size_t nameLength = 0;
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+
+    if (argc < 2 || napi_get_value_string_utf8(env, argv[0], name, sizeof(name), &nameLength) != napi_ok) {
+        napi_throw_type_error(env, NULL, "Expected a kernel name and a Float32Array of input values.");
+        return NULL;
+    }
+    call->kernel = hc_find_kernel(name);
+    if (call->kernel == NULL) {
+        napi_throw_error(env, NULL, "Unknown kernel, see kernels() for the available ones.");
+        return NULL;
+    }
+    if (!float32_array(env, argv[1], &call->data, &call->length)) {
+        napi_throw_type_error(env, NULL, "Input values must be a Float32Array.");
+        return NULL;
+    }
+    size_t outputLength = hc_output_length(call->kernel, call->length);
+    if (outputLength == 0) {
+        napi_throw_range_error(env, NULL, "Input is not a valid size for the kernel.");
+        return NULL;
+    }
+
+    for (size_t i = 2; i < argc; i++) {
+        napi_valuetype type;
+        bool isTyped = false;
+        NAPI_CALL(env, napi_typeof(env, argv[i], &type));
+        NAPI_CALL(env, napi_is_typedarray(env, argv[i], &isTyped));
+        if (isTyped && output == NULL) {
+            size_t length = 0;
+            if (!float32_array(env, argv[i], &call->result, &length) || length < outputLength) {
+                napi_throw_range_error(env, NULL, "Output must be a Float32Array large enough for the kernel.");
+                return NULL;
+            }
+            output = argv[i];
+        } else if (type == napi_object) {
+            options = argv[i];
+        }
+    }
+    call->block = 64;
+    call->threads = 0;
+    if (options != NULL) {
+        call->block = int_option(env, options, "block", call->block);
+        call->threads = int_option(env, options, "threads", call->threads);
+    }
+    if (call->block <= 0) {
+        napi_throw_range_error(env, NULL, "Block size must be positive.");
+        return NULL;
+    }
+
+    if (output == NULL) {
+        napi_value buffer;
+        void* ptr = NULL;
+        NAPI_CALL(env, napi_create_arraybuffer(env, outputLength * sizeof(float), &ptr, &buffer));
+        NAPI_CALL(env, napi_create_typedarray(env, napi_float32_array, outputLength, buffer, 0, &output));
+        call->result = ptr;
+    }
+    return output;
+}
+
+static napi_value with_outcome(napi_env env, napi_value output, const hc_call* call) {
+    napi_value elapsed, status, detail, iterations, converged, memory, allocations, bytes, peak;
+    NAPI_CALL(env, napi_create_double(env, call->elapsed, &elapsed));
+    NAPI_CALL(env, napi_create_int32(env, call->stats.status, &status));
+    NAPI_CALL(env, napi_create_int32(env, call->stats.detail, &detail));
+    NAPI_CALL(env, napi_create_int32(env, call->stats.iterations, &iterations));
+    NAPI_CALL(env, napi_get_boolean(env, call->stats.converged != 0, &converged));
+    NAPI_CALL(env, napi_set_named_property(env, output, "elapsed", elapsed));
+    NAPI_CALL(env, napi_set_named_property(env, output, "status", status));
+    NAPI_CALL(env, napi_set_named_property(env, output, "statusDetail", detail));
+    NAPI_CALL(env, napi_set_named_property(env, output, "iterations", iterations));
+    NAPI_CALL(env, napi_set_named_property(env, output, "converged", converged));
+    NAPI_CALL(env, napi_create_object(env, &memory));
+    NAPI_CALL(env, napi_create_int64(env, call->memory.allocations, &allocations));
+    NAPI_CALL(env, napi_create_int64(env, call->memory.bytes, &bytes));
+    NAPI_CALL(env, napi_create_int64(env, call->memory.peak, &peak));
+    NAPI_CALL(env, napi_set_named_property(env, memory, "allocations", allocations));
+    NAPI_CALL(env, napi_set_named_property(env, memory, "bytes", bytes));
+    NAPI_CALL(env, napi_set_named_property(env, memory, "peak", peak));
+    NAPI_CALL(env, napi_set_named_property(env, output, "memory", memory));
+    return output;
+}
+
+static void execute(napi_env env, void* data) {
+    (void)env;
+    execute_call(data);
+}
+
+static void complete(napi_env env, napi_status status, void* data) {
+    hc_call* call = data;
+    napi_value output = NULL, error, message;
+    napi_get_reference_value(env, call->output, &output);
+    if (status == napi_ok && output != NULL && with_outcome(env, output, call) != NULL) {
+        napi_resolve_deferred(env, call->deferred, output);
+    } else {
+        bool pending = false;
+        napi_is_exception_pending(env, &pending);
+        if (pending) {
+            napi_get_and_clear_last_exception(env, &error);
+        } else {
+            napi_create_string_utf8(env, "Kernel run was cancelled.", NAPI_AUTO_LENGTH, &message);
+            napi_create_error(env, NULL, message, &error);
+        }
+        napi_reject_deferred(env, call->deferred, error);
+    }
+    napi_delete_reference(env, call->input);
+    napi_delete_reference(env, call->output);
+    napi_delete_async_work(env, call->work);
+    free(call);
+}
+
+/**
+ * @brief Releases a call that could not be queued. Failures before the promise exists are thrown, later ones reject
+ * the promise so that it is settled and the deferred released.
+ *
+ * @return The rejected promise, or NULL with a pending exception.
+ */
+static napi_value fail_call(napi_env env, hc_call* call, napi_value promise, const char* message) {
+    napi_value error = NULL, text;
+    bool pending = false;
+    napi_is_exception_pending(env, &pending);
+    if (!pending) napi_throw_error(env, NULL, message);
+    if (call->deferred != NULL) {
+        napi_get_and_clear_last_exception(env, &error);
+        if (error == NULL) {
+            napi_create_string_utf8(env, message, NAPI_AUTO_LENGTH, &text);
+            napi_create_error(env, NULL, text, &error);
+        }
+        napi_reject_deferred(env, call->deferred, error);
+    }
+    if (call->work != NULL) napi_delete_async_work(env, call->work);
+    if (call->input != NULL) napi_delete_reference(env, call->input);
+    if (call->output != NULL) napi_delete_reference(env, call->output);
+    free(call);
+    return promise;
+}
+
+static napi_value run(napi_env env, napi_callback_info info) {
+    napi_value promise = NULL, resource, argv[2];
+    size_t argc = 2;
+    hc_call* call = calloc(1, sizeof(hc_call));
+    if (call == NULL) {
+        napi_throw_error(env, NULL, "Out of memory.");
+        return NULL;
+    }
+    napi_value output = prepare_call(env, info, call);
+    if (output == NULL) {
+        free(call);
+        return NULL;
+    }
+    if (napi_get_cb_info(env, info, &argc, argv, NULL, NULL) != napi_ok ||
+        napi_create_reference(env, argv[1], 1, &call->input) != napi_ok ||
+        napi_create_reference(env, output, 1, &call->output) != napi_ok ||
+        napi_create_promise(env, &call->deferred, &promise) != napi_ok) {
+        return fail_call(env, call, NULL, "Kernel run could not be prepared.");
+    }
+    if (napi_create_string_utf8(env, call->kernel->name, NAPI_AUTO_LENGTH, &resource) != napi_ok ||
+        napi_create_async_work(env, NULL, resource, execute, complete, call, &call->work) != napi_ok ||
+        napi_queue_async_work(env, call->work) != napi_ok) {
+        return fail_call(env, call, promise, "Kernel run could not be queued.");
+    }
+    return promise;
+}
+
+static napi_value run_sync(napi_env env, napi_callback_info info) {
+    hc_call call;
+    memset(&call, 0, sizeof(call));
+    napi_value output = prepare_call(env, info, &call);
+    if (output == NULL) return NULL;
+    execute_call(&call);
+    return with_outcome(env, output, &call);
+}
+
+static napi_value kernels(napi_env env, napi_callback_info info) {
+    (void)info;
+    napi_value list, name;
+    uint32_t i = 0;
+    NAPI_CALL(env, napi_create_array(env, &list));
+    for (const hc_kernel_entry* k = hc_kernels; k->name != NULL; k++, i++) {
+        NAPI_CALL(env, napi_create_string_utf8(env, k->name, NAPI_AUTO_LENGTH, &name));
+        NAPI_CALL(env, napi_set_element(env, list, i, name));
+    }
+    return list;
+}
+
+NAPI_MODULE_INIT() {
+    napi_property_descriptor properties[] = {
+        {"run", NULL, run, NULL, NULL, NULL, napi_default, NULL},
+        {"runSync", NULL, run_sync, NULL, NULL, NULL, napi_default, NULL},
+        {"kernels", NULL, kernels, NULL, NULL, NULL, napi_default, NULL},
+    };
+    NAPI_CALL(env, napi_define_properties(env, exports, sizeof(properties) / sizeof(properties[0]), properties));
+    return exports;
+}
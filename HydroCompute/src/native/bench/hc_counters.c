@@ -0,0 +1,141 @@
+/**
+ * @brief Hardware counters of the benchmarked kernels, read through perf_event_open on Linux.
+ *
+ * Every counter is opened on its own for the calling process, counting user space only, and inherited by the threads
+ * created afterwards, so the counters must be opened before the OpenMP threads are started. The kernel multiplexes
+ * the counters when the PMU has fewer of them, and the counts are scaled by the time each one was scheduled.
+ * Vector instructions have no generic event: the default is the packed floating point instructions retired of Intel
+ * processors, and other processors need the raw event given with --vector-event.
+ */
+#include "hc_counters.h"
+#include <stdio.h>
+#include <string.h>
+
+const char* const hc_counter_names[HC_COUNTER_COUNT] = {
+    "cycles", "instructions", "l1dMisses", "llcMisses", "branchMisses", "vectorInstructions"};
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+/* FP_ARITH_INST_RETIRED, packed single and double precision of every width */
+#define HC_INTEL_VECTOR_EVENT 0xFCC7
+
+static int fds[HC_COUNTER_COUNT] = {-1, -1, -1, -1, -1, -1};
+static uint64_t started[HC_COUNTER_COUNT][3];
+
+static uint64_t cache_miss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+/**
+ * @brief Default raw event of the vector instructions, 0 if the processor has none.
+ */
+static uint64_t default_vector_event(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0, &eax, &ebx, &ecx, &edx) && ebx == 0x756e6547 && edx == 0x49656e69 && ecx == 0x6c65746e) {
+        return HC_INTEL_VECTOR_EVENT;
+    }
+#endif
+    return 0;
+}
+
+/**
+ * @brief Reads the count of a counter along with the times it was enabled and running.
+ */
+static int read_counter(int fd, uint64_t value[3]) {
+    return read(fd, value, 3 * sizeof(uint64_t)) == 3 * sizeof(uint64_t);
+}
+
+int hc_counters_open(uint64_t vector_event) {
+    const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[HC_COUNTER_COUNT] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+        {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_RAW, vector_event != 0 ? vector_event : default_vector_event()},
+    };
+    int opened = 0;
+    for (int c = 0; c < HC_COUNTER_COUNT; c++) {
+        if (events[c].type == PERF_TYPE_RAW && events[c].config == 0) {
+            fprintf(stderr, "Counter %s: no default event for this processor, see --vector-event.\n",
+                hc_counter_names[c]);
+            continue;
+        }
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[c].type;
+        attr.config = events[c].config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds[c] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fds[c] < 0) {
+            fprintf(stderr, "Counter %s: %s.\n", hc_counter_names[c], strerror(errno));
+            continue;
+        }
+        opened++;
+    }
+    return opened;
+}
+
+void hc_counters_start(void) {
+    for (int c = 0; c < HC_COUNTER_COUNT; c++) {
+        if (fds[c] < 0) continue;
+        if (!read_counter(fds[c], started[c])) memset(started[c], 0, sizeof(started[c]));
+        ioctl(fds[c], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void hc_counters_stop(hc_counter_values* values) {
+    for (int c = 0; c < HC_COUNTER_COUNT; c++) {
+        if (fds[c] >= 0) ioctl(fds[c], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for (int c = 0; c < HC_COUNTER_COUNT; c++) {
+        uint64_t stopped[3];
+        values->values[c] = -1;
+        if (fds[c] < 0 || !read_counter(fds[c], stopped)) continue;
+        double enabled = (double)(stopped[1] - started[c][1]), running = (double)(stopped[2] - started[c][2]);
+        //Counters never scheduled while enabled have no count
+        values->values[c] = running > 0 ? (double)(stopped[0] - started[c][0]) * enabled / running : -1;
+    }
+}
+
+void hc_counters_close(void) {
+    for (int c = 0; c < HC_COUNTER_COUNT; c++) {
+        if (fds[c] >= 0) close(fds[c]);
+        fds[c] = -1;
+    }
+}
+
+#else
+
+int hc_counters_open(uint64_t vector_event) {
+    (void)vector_event;
+    fprintf(stderr, "Hardware counters are only read on Linux.\n");
+    return 0;
+}
+
+void hc_counters_start(void) {}
+
+void hc_counters_stop(hc_counter_values* values) {
+    for (int c = 0; c < HC_COUNTER_COUNT; c++) values->values[c] = -1;
+}
+
+void hc_counters_close(void) {}
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * @brief Hardware counters of the benchmarked kernels, read through perf_event_open on Linux.
+ *
+ */
+#ifndef HC_COUNTERS_H
+#define HC_COUNTERS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Counters collected around the timed runs.
+ */
+enum hc_counter {
+    HC_COUNTER_CYCLES,
+    HC_COUNTER_INSTRUCTIONS,
+    HC_COUNTER_L1D_MISSES,
+    HC_COUNTER_LLC_MISSES,
+    HC_COUNTER_BRANCH_MISSES,
+    HC_COUNTER_VECTOR,
+    HC_COUNTER_COUNT
+};
+
+/* Names of the counters in the output */
+extern const char* const hc_counter_names[HC_COUNTER_COUNT];
+
+/**
+ * @brief Values of the counters between hc_counters_start and hc_counters_stop, scaled for the time each was
+ * scheduled on the PMU. Counters that could not be opened are negative.
+ */
+typedef struct {
+    double values[HC_COUNTER_COUNT];
+} hc_counter_values;
+
+/* Opens the counters of the process and of the threads it creates afterwards. vector_event is the raw event
+   counting vector instructions, 0 for the default of the processor. Returns the number of counters opened */
+int hc_counters_open(uint64_t vector_event);
+
+/* Starts counting */
+void hc_counters_start(void);
+
+/* Stops counting and stores the counts since hc_counters_start */
+void hc_counters_stop(hc_counter_values* values);
+
+/* Closes the counters */
+void hc_counters_close(void);
+
+#endif
@@ -0,0 +1,372 @@
+/**
+ * @brief Microbenchmarks of the native HydroCompute kernels.
+ *
+ * Sweeps the input sizes of each kernel, times repeated runs and reports the median and
+ * percentile timings along with the achieved GFLOP/s and GB/s. The machine is measured
+ * first (a multiply-add loop for the compute peak and a triad for the memory bandwidth),
+ * and every result is placed against the roofline those two numbers define. Results are
+ * written as JSON, one kernel and size per entry, so runs can be diffed across versions.
+ *
+ * With --counters, the hardware counters of the timed runs (cycles, instructions, L1 data and last level cache
+ * misses, branch misses and vector instructions) are read through perf_event_open and reported per run, to tell
+ * whether a kernel is bound by memory or by compute.
+ *
+ * Usage:
+ *   hydrocompute_bench [--kernel name[,name...]] [--sizes n[,n...]] [--reps n] [--threads n]
+ *                      [--block n] [--output file] [--quick] [--counters] [--vector-event hex]
+ *
+ */
+#include "hc_registry.h"
+#include "hc_counters.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef HC_BENCH_VERSION
+#define HC_BENCH_VERSION "unknown"
+#endif
+
+#define HC_BENCH_MAX_SIZES 16
+#define HC_BENCH_MAX_REPS 1000
+
+/**
+ * @brief Size of one benchmark and the work it represents.
+ */
+typedef struct {
+    double flops;  /* floating point operations of one run, 0 when not meaningful */
+    double bytes;  /* compulsory memory traffic of one run */
+    double items;  /* items processed by one run, reported as a rate */
+} hc_work;
+
+/**
+ * @brief Kernel benchmarked, with its default sizes and its work model.
+ */
+typedef struct {
+    const char* name;
+    const char* unit;  /* unit of the sizes */
+    const char* items; /* unit of the items */
+    long sizes[HC_BENCH_MAX_SIZES];
+    long quick[HC_BENCH_MAX_SIZES];
+    hc_work (*work)(long size);
+} hc_bench;
+
+/* Work models. Sizes are the side of the matrices, or the length of the series */
+
+static hc_work gemm_work(long n) {
+    double nn = (double)n * n;
+    return (hc_work){2.0 * nn * n, 3.0 * nn * sizeof(float), nn};
+}
+
+static hc_work acf_work(long n) {
+    //Four operations per lagged product, over n(n+1)/2 products
+    return (hc_work){2.0 * n * (n + 1.0), 2.0 * n * sizeof(float), (double)n};
+}
+
+static hc_work pacf_work(long n) {
+    //Dominant terms of the Durbin-Levinson recursion and of the residual sums, the final pass adds up to n^3/3
+    return (hc_work){2.0 * n * n * (double)n / 3.0, 2.0 * n * sizeof(float), (double)n};
+}
+
+static hc_work arima_work(long n) {
+    //Twelve operations per value and iteration, iterations taken from the statistics of the run
+    int iterations = hc_last_stats()->iterations;
+    return (hc_work){(12.0 * iterations + 8.0) * n, 2.0 * n * sizeof(float), (double)n};
+}
+
+static hc_work montecarlo_work(long n) {
+    //Dominated by transcendental functions, reported as simulated days instead of operations
+    return (hc_work){0, (n + (double)HC_MC_SIMULATIONS) * sizeof(float), 365.0 * HC_MC_SIMULATIONS};
+}
+
+static const hc_bench BENCHES[] = {
+    {"matrixMultiply_c", "side", "elements", {128, 256, 512, 1024}, {64, 128}, gemm_work},
+    {"bmm", "side", "elements", {128, 256, 512, 1024}, {64, 128}, gemm_work},
+    {"acf", "values", "values", {1000, 10000, 100000}, {1000, 4000}, acf_work},
+    {"pacf", "values", "values", {128, 256, 512}, {64, 128}, pacf_work},
+    {"arima_autoParams", "values", "values", {10000, 100000, 1000000}, {10000}, arima_work},
+    {"monteCarlo_c", "values", "days", {365, 3650, 36500}, {365}, montecarlo_work},
+};
+
+#define HC_BENCH_COUNT (sizeof(BENCHES) / sizeof(BENCHES[0]))
+
+static volatile double benchmark_sink;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Percentile of sorted timings, interpolated between the closest ranks.
+ */
+static double percentile(const double* sorted, int count, double p) {
+    double rank = p * (count - 1);
+    int low = (int)floor(rank), high = (int)ceil(rank);
+    return sorted[low] + (sorted[high] - sorted[low]) * (rank - low);
+}
+
+/**
+ * @brief Synthetic daily discharge: seasonal cycle, storm peaks and noise, reproducible across runs.
+ */
+static void synthetic_series(float* values, size_t n, uint32_t seed) {
+    uint32_t state = seed != 0 ? seed : 1;
+    for (size_t i = 0; i < n; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        float noise = (float)(state >> 8) / 16777216.0f;
+        float storm = (state & 0xFF) < 3 ? 40.0f * noise : 0.0f;
+        values[i] = 20.0f + 8.0f * sinf(2.0f * 3.14159265f * (float)(i % 365) / 365.0f) + 2.0f * noise + storm;
+    }
+}
+
+/**
+ * @brief Peak multiply-add throughput, with independent accumulators on every thread.
+ *
+ * @return The peak in GFLOP/s.
+ */
+static double measure_peak_gflops(void) {
+    const long rounds = 1L << 22;
+    double start = now_seconds(), checksum = 0;
+    int threads = 1;
+    #pragma omp parallel reduction(+ : checksum)
+    {
+        float acc[64];
+        for (int v = 0; v < 64; v++) acc[v] = (float)v * 1e-3f;
+        for (long r = 0; r < rounds; r++) {
+            for (int v = 0; v < 64; v++) acc[v] = acc[v] * 0.999999f + 1e-7f;
+        }
+        for (int v = 0; v < 64; v++) checksum += acc[v];
+#ifdef _OPENMP
+        #pragma omp single
+        threads = omp_get_num_threads();
+#endif
+    }
+    double elapsed = now_seconds() - start;
+    //Keeps the accumulators alive
+    benchmark_sink = checksum;
+    return 2.0 * 64.0 * rounds * threads / elapsed / 1e9;
+}
+
+/**
+ * @brief Sustained memory bandwidth of a triad over arrays much larger than the caches.
+ *
+ * @return The bandwidth in GB/s.
+ */
+static double measure_bandwidth(void) {
+    const long n = 16L * 1024 * 1024;
+    float *a = malloc(n * sizeof(float)), *b = malloc(n * sizeof(float)), *c = malloc(n * sizeof(float));
+    if (a == NULL || b == NULL || c == NULL) {
+        free(a), free(b), free(c);
+        return 0;
+    }
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++) {
+        a[i] = 0, b[i] = 1, c[i] = 2;
+    }
+    double best = INFINITY;
+    for (int rep = 0; rep < 5; rep++) {
+        double start = now_seconds();
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < n; i++) {
+            a[i] = b[i] + 0.5f * c[i];
+        }
+        double elapsed = now_seconds() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    free(a), free(b), free(c);
+    return 3.0 * n * sizeof(float) / best / 1e9;
+}
+
+static int parse_list(const char* text, long* values, int max) {
+    int count = 0;
+    char* end;
+    while (*text != '\0' && count < max) {
+        values[count++] = strtol(text, &end, 10);
+        if (end == text) return -1;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+static int selected(const char* list, const char* name) {
+    if (list == NULL) return 1;
+    size_t length = strlen(name);
+    for (const char* p = list; (p = strstr(p, name)) != NULL; p += length) {
+        if ((p == list || p[-1] == ',') && (p[length] == '\0' || p[length] == ',')) return 1;
+    }
+    return 0;
+}
+
+static void usage(FILE* out) {
+    fprintf(out,
+        "Usage: hydrocompute_bench [--kernel name[,name...]] [--sizes n[,n...]] [--reps n]\n"
+        "                          [--threads n] [--block n] [--output file] [--quick]\n"
+        "                          [--counters] [--vector-event hex]\n"
+        "Kernels:");
+    for (size_t i = 0; i < HC_BENCH_COUNT; i++) fprintf(out, " %s", BENCHES[i].name);
+    fprintf(out, "\n");
+}
+
+int main(int argc, char** argv) {
+    const char* kernels = NULL;
+    const char* output = NULL;
+    long sizes[HC_BENCH_MAX_SIZES];
+    int sizeCount = 0, reps = 7, threads = 0, block = 64, quick = 0, counters = 0;
+    uint64_t vectorEvent = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--help") == 0) {
+            usage(stdout);
+            return 0;
+        } else if (strcmp(arg, "--quick") == 0) {
+            quick = 1;
+            continue;
+        } else if (strcmp(arg, "--counters") == 0) {
+            counters = 1;
+            continue;
+        } else if (value == NULL) {
+            usage(stderr);
+            return 1;
+        } else if (strcmp(arg, "--kernel") == 0) {
+            kernels = value;
+        } else if (strcmp(arg, "--sizes") == 0) {
+            sizeCount = parse_list(value, sizes, HC_BENCH_MAX_SIZES);
+        } else if (strcmp(arg, "--reps") == 0) {
+            reps = atoi(value);
+        } else if (strcmp(arg, "--threads") == 0) {
+            threads = atoi(value);
+        } else if (strcmp(arg, "--block") == 0) {
+            block = atoi(value);
+        } else if (strcmp(arg, "--output") == 0) {
+            output = value;
+        } else if (strcmp(arg, "--vector-event") == 0) {
+            vectorEvent = strtoull(value, NULL, 16);
+        } else {
+            usage(stderr);
+            return 1;
+        }
+        i++;
+    }
+    if (sizeCount < 0 || reps < 1 || reps > HC_BENCH_MAX_REPS || block < 1) {
+        fprintf(stderr, "Invalid sizes, repetitions or block size.\n");
+        return 1;
+    }
+    //Counters are inherited by the threads created after they are opened, so before the OpenMP threads
+    if (counters && hc_counters_open(vectorEvent) == 0) {
+        fprintf(stderr, "No hardware counters could be opened, they are reported as null.\n");
+    }
+#ifdef _OPENMP
+    if (threads > 0) omp_set_num_threads(threads);
+    threads = omp_get_max_threads();
+#else
+    threads = 1;
+#endif
+
+    FILE* out = output != NULL ? fopen(output, "w") : stdout;
+    if (out == NULL) {
+        fprintf(stderr, "Cannot write %s.\n", output);
+        return 1;
+    }
+
+    fprintf(stderr, "Measuring the machine...\n");
+    double peak = measure_peak_gflops(), bandwidth = measure_bandwidth();
+    fprintf(out, "{\n  \"version\": \"%s\",\n  \"threads\": %d,\n  \"reps\": %d,\n  \"counters\": %s,\n",
+        HC_BENCH_VERSION, threads, reps, counters ? "true" : "false");
+    fprintf(out, "  \"machine\": {\"peakGflops\": %.2f, \"bandwidthGBs\": %.2f},\n", peak, bandwidth);
+    fprintf(out, "  \"results\": [");
+
+    int first = 1, status = 0;
+    for (size_t b = 0; b < HC_BENCH_COUNT; b++) {
+        const hc_bench* bench = &BENCHES[b];
+        if (!selected(kernels, bench->name)) continue;
+        const hc_kernel_entry* kernel = hc_find_kernel(bench->name);
+        const long* list = sizeCount > 0 ? sizes : quick ? bench->quick : bench->sizes;
+        for (int s = 0; s < HC_BENCH_MAX_SIZES && list[s] > 0 && (sizeCount == 0 || s < sizeCount); s++) {
+            long size = list[s];
+            int matrix = kernel->kind == HC_KIND_MATRIX || kernel->kind == HC_KIND_BLOCKED;
+            size_t n = matrix ? 2 * (size_t)size * size : (size_t)size;
+            size_t outputs = hc_output_length(kernel, n);
+            float* data = malloc(n * sizeof(float));
+            float* result = malloc(outputs * sizeof(float));
+            if (data == NULL || result == NULL || outputs == 0) {
+                fprintf(stderr, "Cannot run %s over %ld %s.\n", bench->name, size, bench->unit);
+                free(data), free(result);
+                status = 1;
+                continue;
+            }
+            synthetic_series(data, n, (uint32_t)(size * 2654435761u));
+
+            //One warm-up run, then the timed repetitions
+            double times[HC_BENCH_MAX_REPS];
+            hc_counter_values counts;
+            hc_run_kernel(kernel, data, result, n, block);
+            counters ? hc_counters_start() : (void)0;
+            for (int r = 0; r < reps; r++) {
+                double start = now_seconds();
+                hc_run_kernel(kernel, data, result, n, block);
+                times[r] = now_seconds() - start;
+            }
+            counters ? hc_counters_stop(&counts) : (void)0;
+            hc_work work = bench->work(size);
+            qsort(times, reps, sizeof(double), compare_doubles);
+            double median = percentile(times, reps, 0.5);
+            double gflops = work.flops / median / 1e9, gbs = work.bytes / median / 1e9;
+            double intensity = work.bytes > 0 ? work.flops / work.bytes : 0;
+            double roof = fmin(peak, intensity * bandwidth);
+
+            fprintf(out, "%s\n    {\"kernel\": \"%s\", \"size\": %ld, \"unit\": \"%s\", ", first ? "" : ",",
+                bench->name, size, bench->unit);
+            fprintf(out, "\"median_ms\": %.4f, \"p10_ms\": %.4f, \"p90_ms\": %.4f, \"min_ms\": %.4f, ",
+                median * 1e3, percentile(times, reps, 0.1) * 1e3, percentile(times, reps, 0.9) * 1e3, times[0] * 1e3);
+            if (work.flops > 0) {
+                fprintf(out, "\"gflops\": %.3f, \"intensity\": %.3f, \"rooflineGflops\": %.3f, \"efficiency\": %.3f, ",
+                    gflops, intensity, roof, roof > 0 ? gflops / roof : 0);
+            } else {
+                fprintf(out, "\"gflops\": null, \"intensity\": null, \"rooflineGflops\": null, \"efficiency\": null, ");
+            }
+            fprintf(out, "\"gbs\": %.3f, \"rate\": %.4g, \"rateUnit\": \"%s/s\"", gbs, work.items / median,
+                bench->items);
+            fprintf(stderr, "%-18s %8ld %-6s median %10.3f ms", bench->name, size, bench->unit, median * 1e3);
+            if (counters) {
+                //Counts per run, null when the counter is not available
+                fprintf(out, ", \"counters\": {");
+                for (int c = 0; c < HC_COUNTER_COUNT; c++) {
+                    double value = counts.values[c] / reps;
+                    value >= 0 ? fprintf(out, "\"%s\": %.0f, ", hc_counter_names[c], value)
+                               : fprintf(out, "\"%s\": null, ", hc_counter_names[c]);
+                }
+                double cycles = counts.values[HC_COUNTER_CYCLES], instructions = counts.values[HC_COUNTER_INSTRUCTIONS];
+                cycles > 0 && instructions >= 0 ? fprintf(out, "\"ipc\": %.3f}", instructions / cycles)
+                                                : fprintf(out, "\"ipc\": null}");
+                cycles > 0 && instructions >= 0 ? fprintf(stderr, "  ipc %5.2f", instructions / cycles) : 0;
+                counts.values[HC_COUNTER_LLC_MISSES] >= 0
+                    ? fprintf(stderr, "  llc misses %.3g", counts.values[HC_COUNTER_LLC_MISSES] / reps)
+                    : 0;
+            }
+            fprintf(out, "}");
+            fprintf(stderr, "\n");
+            first = 0;
+            free(data);
+            free(result);
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) fclose(out);
+    counters ? hc_counters_close() : (void)0;
+    return status;
+}
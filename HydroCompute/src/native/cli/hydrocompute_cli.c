@@ -0,0 +1,447 @@
+/**
+ * @brief Command-line batch runner of the HydroCompute kernels.
+ *
+ * Runs a kernel over many series stored in binary (float32) or CSV files. Inputs are
+ * memory-mapped and split into series of a fixed length, and the series of every file
+ * are run by a pool of threads. Results are written per input file as binary or CSV.
+ *
+ * Usage:
+ *   hydrocompute --kernel acf --series 8760 --threads 8 --format csv --output out/ a.f32 b.csv
+ *   hydrocompute --job nightly.job
+ *
+ * A job file holds the same options as "key = value" lines, with one input per line:
+ *   kernel = acf
+ *   series = 8760
+ *   input = a.f32
+ *   input = b.csv
+ *   output = out/
+ *
+ */
+#include "hc_registry.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define HC_MAX_INPUTS 4096
+#define HC_MAX_LINE 4096
+
+/**
+ * @brief Options of a job.
+ */
+typedef struct {
+    const hc_kernel_entry* kernel;
+    const char* inputs[HC_MAX_INPUTS];
+    int inputCount;
+    const char* output;
+    int csv;
+    long series;
+    int threads;
+    int block;
+} hc_job;
+
+/**
+ * @brief Input file along with the results of its series.
+ */
+typedef struct {
+    const char* path;
+    void* mapping;
+    size_t mappedBytes;
+    float* values;
+    int ownsValues;
+    size_t count;
+    size_t seriesLength;
+    size_t seriesCount;
+    size_t outputLength;
+    float* results;
+    atomic_size_t remaining;
+} hc_input;
+
+/**
+ * @brief State shared by the threads of the pool.
+ */
+typedef struct {
+    const hc_job* job;
+    hc_input* inputs;
+    size_t* firstTask;
+    size_t taskCount;
+    atomic_size_t next;
+    atomic_int status;
+} hc_pool;
+
+static int ends_with(const char* text, const char* suffix) {
+    size_t a = strlen(text), b = strlen(suffix);
+    return a >= b && strcmp(text + a - b, suffix) == 0;
+}
+
+static void usage(FILE* out) {
+    fprintf(out,
+        "Usage: hydrocompute [options] inputs...\n"
+        "       hydrocompute --job file\n\n"
+        "Options:\n"
+        "  --kernel name    kernel to run\n"
+        "  --series n       values per series, 0 for the whole file (default 0)\n"
+        "  --threads n      threads of the pool (default: all cores)\n"
+        "  --format f       output format, binary or csv (default binary)\n"
+        "  --output dir     output directory (default .)\n"
+        "  --block n        block size of bmm (default 32)\n"
+        "  --job file       reads the options and inputs from a job file\n\n"
+        "Inputs ending in .csv are parsed as text, any other file as little endian float32.\n"
+        "Kernels:");
+    for (const hc_kernel_entry* k = hc_kernels; k->name != NULL; k++) {
+        fprintf(out, " %s", k->name);
+    }
+    fprintf(out, "\n");
+}
+
+/**
+ * @brief Applies an option by name, from the command line or a job file.
+ *
+ * @return 0 on success, -1 if the option or its value is not valid.
+ */
+static int set_option(hc_job* job, const char* key, const char* value) {
+    if (strcmp(key, "kernel") == 0) {
+        job->kernel = hc_find_kernel(value);
+        if (job->kernel == NULL) {
+            fprintf(stderr, "Unknown kernel: %s\n", value);
+            return -1;
+        }
+    } else if (strcmp(key, "input") == 0) {
+        if (job->inputCount == HC_MAX_INPUTS) {
+            fprintf(stderr, "Too many inputs, the maximum is %d.\n", HC_MAX_INPUTS);
+            return -1;
+        }
+        job->inputs[job->inputCount++] = value;
+    } else if (strcmp(key, "output") == 0) {
+        job->output = value;
+    } else if (strcmp(key, "format") == 0) {
+        if (strcmp(value, "csv") != 0 && strcmp(value, "binary") != 0) {
+            fprintf(stderr, "Unknown format: %s\n", value);
+            return -1;
+        }
+        job->csv = strcmp(value, "csv") == 0;
+    } else if (strcmp(key, "series") == 0) {
+        job->series = atol(value);
+    } else if (strcmp(key, "threads") == 0) {
+        job->threads = atoi(value);
+    } else if (strcmp(key, "block") == 0) {
+        job->block = atoi(value);
+    } else {
+        fprintf(stderr, "Unknown option: %s\n", key);
+        return -1;
+    }
+    return 0;
+}
+
+static char* trim(char* text) {
+    while (*text == ' ' || *text == '\t') text++;
+    char* end = text + strlen(text);
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+    return text;
+}
+
+/**
+ * @brief Reads a job file of "key = value" lines. Text after # is ignored.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+static int read_job(hc_job* job, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot open job file %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    char line[HC_MAX_LINE];
+    int number = 0, status = 0;
+    while (status == 0 && fgets(line, sizeof(line), file) != NULL) {
+        number++;
+        char* comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+        char* text = trim(line);
+        if (*text == '\0') continue;
+        char* equals = strchr(text, '=');
+        if (equals == NULL) {
+            fprintf(stderr, "%s:%d: expected key = value\n", path, number);
+            status = -1;
+            break;
+        }
+        *equals = '\0';
+        //Values outlive the file, they are kept for the whole job
+        status = set_option(job, trim(text), strdup(trim(equals + 1)));
+    }
+    fclose(file);
+    return status;
+}
+
+/**
+ * @brief Parses every number of a CSV mapping. Separators are commas, semicolons and
+ * whitespace, and tokens that are not numbers (e.g. headers) are skipped.
+ */
+static float* parse_csv(const char* text, size_t bytes, size_t* count) {
+    size_t capacity = 1024, n = 0;
+    float* values = malloc(capacity * sizeof(float));
+    char token[128];
+    size_t i = 0;
+    while (values != NULL && i < bytes) {
+        while (i < bytes && strchr(",; \t\r\n", text[i]) != NULL) i++;
+        size_t length = 0;
+        while (i < bytes && strchr(",; \t\r\n", text[i]) == NULL) {
+            if (length < sizeof(token) - 1) token[length++] = text[i];
+            i++;
+        }
+        if (length == 0) continue;
+        token[length] = '\0';
+        char* end;
+        float value = strtof(token, &end);
+        if (end == token) continue;
+        if (n == capacity) {
+            capacity *= 2;
+            float* grown = realloc(values, capacity * sizeof(float));
+            if (grown == NULL) {
+                free(values);
+                return NULL;
+            }
+            values = grown;
+        }
+        values[n++] = value;
+    }
+    *count = n;
+    return values;
+}
+
+/**
+ * @brief Maps an input file and lays out its series.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+static int open_input(hc_input* input, const hc_job* job) {
+    int fd = open(input->path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", input->path, strerror(errno));
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        fprintf(stderr, "Input %s is empty or cannot be read.\n", input->path);
+        close(fd);
+        return -1;
+    }
+    input->mappedBytes = (size_t)info.st_size;
+    //Private writable mapping: the kernels take mutable pointers but never write their input,
+    //so pages are shared with the page cache and never copied
+    input->mapping = mmap(NULL, input->mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (input->mapping == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s: %s\n", input->path, strerror(errno));
+        input->mapping = NULL;
+        return -1;
+    }
+    if (ends_with(input->path, ".csv")) {
+        input->values = parse_csv(input->mapping, input->mappedBytes, &input->count);
+        input->ownsValues = 1;
+        munmap(input->mapping, input->mappedBytes);
+        input->mapping = NULL;
+        if (input->values == NULL) {
+            fprintf(stderr, "Out of memory parsing %s\n", input->path);
+            return -1;
+        }
+    } else {
+        //Series are read in place from the page cache, sequential access is hinted
+        madvise(input->mapping, input->mappedBytes, MADV_SEQUENTIAL);
+        input->values = input->mapping;
+        input->count = input->mappedBytes / sizeof(float);
+    }
+
+    input->seriesLength = job->series > 0 ? (size_t)job->series : input->count;
+    if (input->seriesLength == 0 || input->count < input->seriesLength) {
+        fprintf(stderr, "Input %s holds fewer values than a series.\n", input->path);
+        return -1;
+    }
+    if (input->count % input->seriesLength != 0) {
+        fprintf(stderr, "Warning: the last %zu values of %s do not fill a series and are skipped.\n",
+            input->count % input->seriesLength, input->path);
+    }
+    input->seriesCount = input->count / input->seriesLength;
+
+    input->outputLength = hc_output_length(job->kernel, input->seriesLength);
+    if (input->outputLength == 0) {
+        //Matrix kernels expect each series to hold two square matrices one after the other
+        fprintf(stderr, "Series of %s are not a valid input of %s.\n", input->path, job->kernel->name);
+        return -1;
+    }
+    input->results = calloc(input->seriesCount * input->outputLength, sizeof(float));
+    if (input->results == NULL) {
+        fprintf(stderr, "Out of memory allocating the results of %s\n", input->path);
+        return -1;
+    }
+    atomic_init(&input->remaining, input->seriesCount);
+    return 0;
+}
+
+static void close_input(hc_input* input) {
+    if (input->mapping != NULL) munmap(input->mapping, input->mappedBytes);
+    if (input->ownsValues) free(input->values);
+    free(input->results);
+    input->mapping = NULL;
+    input->values = NULL;
+    input->results = NULL;
+}
+
+/**
+ * @brief Writes the results of an input once all its series are done.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+static int write_results(const hc_input* input, const hc_job* job) {
+    const char* base = strrchr(input->path, '/');
+    base = base != NULL ? base + 1 : input->path;
+    char path[HC_MAX_LINE];
+    snprintf(path, sizeof(path), "%s/%s.%s.%s", job->output, base, job->kernel->name,
+        job->csv ? "csv" : "f32");
+    FILE* file = fopen(path, job->csv ? "w" : "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    int status = 0;
+    if (job->csv) {
+        //One line per series
+        for (size_t s = 0; s < input->seriesCount; s++) {
+            const float* row = input->results + s * input->outputLength;
+            for (size_t i = 0; i < input->outputLength; i++) {
+                fprintf(file, i == 0 ? "%.9g" : ",%.9g", row[i]);
+            }
+            fputc('\n', file);
+        }
+    } else {
+        size_t total = input->seriesCount * input->outputLength;
+        status = fwrite(input->results, sizeof(float), total, file) == total ? 0 : -1;
+    }
+    if (fclose(file) != 0 || status != 0) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static void* worker(void* arg) {
+    hc_pool* pool = arg;
+#ifdef _OPENMP
+    //The pool already keeps every core busy, kernels stay on their thread
+    if (pool->job->threads > 1) omp_set_num_threads(1);
+#endif
+    for (;;) {
+        size_t task = atomic_fetch_add(&pool->next, 1);
+        if (task >= pool->taskCount) break;
+        size_t file = 0;
+        while (pool->firstTask[file + 1] <= task) file++;
+        hc_input* input = &pool->inputs[file];
+        size_t series = task - pool->firstTask[file];
+        hc_run_kernel(pool->job->kernel, input->values + series * input->seriesLength,
+            input->results + series * input->outputLength, input->seriesLength, pool->job->block);
+        //The thread finishing the last series of a file writes it
+        if (atomic_fetch_sub(&input->remaining, 1) == 1) {
+            if (write_results(input, pool->job) != 0) {
+                atomic_store(&pool->status, 2);
+            }
+            close_input(input);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    hc_job job = {0};
+    job.output = ".";
+    job.block = 32;
+    job.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            usage(stdout);
+            return 0;
+        }
+        if (strncmp(argv[i], "--", 2) != 0) {
+            if (set_option(&job, "input", argv[i]) != 0) return 1;
+            continue;
+        }
+        if (i + 1 == argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        int status = strcmp(argv[i], "--job") == 0
+            ? read_job(&job, argv[i + 1])
+            : set_option(&job, argv[i] + 2, argv[i + 1]);
+        if (status != 0) return 1;
+        i++;
+    }
+    if (job.kernel == NULL || job.inputCount == 0) {
+        usage(stderr);
+        return 1;
+    }
+    if (job.threads < 1) job.threads = 1;
+    if (mkdir(job.output, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create %s: %s\n", job.output, strerror(errno));
+        return 2;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    hc_input* inputs = calloc(job.inputCount, sizeof(hc_input));
+    size_t* firstTask = calloc(job.inputCount + 1, sizeof(size_t));
+    if (inputs == NULL || firstTask == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 2;
+    }
+    for (int f = 0; f < job.inputCount; f++) {
+        inputs[f].path = job.inputs[f];
+        if (open_input(&inputs[f], &job) != 0) {
+            for (int g = 0; g <= f; g++) close_input(&inputs[g]);
+            return 2;
+        }
+        firstTask[f + 1] = firstTask[f] + inputs[f].seriesCount;
+    }
+
+    hc_pool pool = {.job = &job, .inputs = inputs, .firstTask = firstTask};
+    pool.taskCount = firstTask[job.inputCount];
+    atomic_init(&pool.next, 0);
+    atomic_init(&pool.status, 0);
+    if ((size_t)job.threads > pool.taskCount) job.threads = (int)pool.taskCount;
+
+    pthread_t* threads = malloc(job.threads * sizeof(pthread_t));
+    int started = 0;
+    for (; threads != NULL && started < job.threads; started++) {
+        if (pthread_create(&threads[started], NULL, worker, &pool) != 0) break;
+    }
+    if (started == 0) {
+        //No thread could be started, the series run on the main thread
+        worker(&pool);
+    }
+    for (int t = 0; t < started; t++) pthread_join(threads[t], NULL);
+    free(threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    size_t values = 0;
+    for (int f = 0; f < job.inputCount; f++) values += inputs[f].seriesCount * inputs[f].seriesLength;
+    fprintf(stderr, "%s: %d files, %zu series, %zu values in %.3f s on %d threads (%.1f Mvalues/s)\n",
+        job.kernel->name, job.inputCount, pool.taskCount, values, seconds, started > 0 ? started : 1,
+        seconds > 0 ? values / seconds / 1e6 : 0.0);
+
+    free(inputs);
+    free(firstTask);
+    return atomic_load(&pool.status);
+}
@@ -0,0 +1,137 @@
+/**
+ * @brief Native runtime of the HydroCompute kernels.
+ *
+ * Provides the allocator and status word shared by all the kernel files linked into the native
+ * libraries, and the batched entry point running a series kernel over many series in parallel.
+ *
+ */
+#include "../wasm/modules/C/hydrocompute.h"
+#include <stdlib.h>
+#include <stddef.h>
+
+/**
+ * @brief Allocates memory of a specified size.
+ *
+ * @param size The size of the memory to allocate.
+ * @return A pointer to the allocated memory.
+ */
+HC_EXPORT
+uint8_t* createMem(size_t size) {
+	return hc_malloc(size);
+}
+
+/**
+ * @brief Deallocates the memory pointed to by the given pointer.
+ *
+ * @param p A pointer to the memory to be deallocated.
+ */
+HC_EXPORT
+void destroy(uint8_t* p){
+	hc_free(p);
+}
+
+/**
+ * @brief Size of the pointers of the build, 8 in Memory64 builds.
+ *
+ * @return The size of a pointer in bytes.
+ */
+HC_EXPORT
+int hc_pointer_size(void) {
+	return (int)sizeof(void*);
+}
+
+/* Kernels run concurrently on many threads, each keeps the statistics of its own last call */
+static _Thread_local hc_stats stats = {HC_OK, 0, 0, 0};
+
+/**
+ * @brief Records the outcome of a kernel call on the calling thread.
+ *
+ * @param code The status code.
+ * @param detail The detail of the status.
+ */
+void hc_set_status(int code, int detail) {
+	stats.status = code;
+	stats.detail = detail;
+}
+
+/**
+ * @brief Records the iterations run by an iterative kernel on the calling thread.
+ *
+ * @param iterations The iterations run.
+ * @param converged 1 if the kernel reached its tolerance, 0 otherwise.
+ */
+void hc_set_iterations(int iterations, int converged) {
+	stats.iterations = iterations;
+	stats.converged = converged;
+}
+
+/**
+ * @brief Clears the statistics before a kernel call on the calling thread.
+ */
+HC_EXPORT
+void hc_reset_stats(void) {
+	stats = (hc_stats){HC_OK, 0, 0, 0};
+}
+
+/**
+ * @brief Statistics of the last kernel call on the calling thread.
+ *
+ * @return A pointer to the status, detail, iterations and convergence flag of the call.
+ */
+HC_EXPORT
+const hc_stats* hc_last_stats(void) {
+	return &stats;
+}
+
+/**
+ * @brief Status of the last kernel call on the calling thread.
+ *
+ * @return HC_OK, HC_NOT_CONVERGED or HC_OUT_OF_MEMORY.
+ */
+HC_EXPORT
+int hc_status(void) {
+	return stats.status;
+}
+
+/**
+ * @brief Detail of the status of the last kernel call on the calling thread.
+ *
+ * @return The iterations to converge for arima_autoParams, or the optimal lag for pacf.
+ */
+HC_EXPORT
+int hc_status_detail(void) {
+	return stats.detail;
+}
+
+/**
+ * @brief Precomputes the tables of all the kernel files.
+ *
+ * Runs when the library is loaded, before kernels can be called from several threads.
+ */
+HC_EXPORT
+#if defined(__GNUC__)
+__attribute__((constructor))
+#endif
+void hc_initialize(void) {
+	hc_monteCarlo_initialize();
+}
+
+/**
+ * @brief Runs a series kernel over a batch of series in parallel.
+ *
+ * Series are stored one after the other, and each result is written at the same offset
+ * as its series.
+ *
+ * @param kernel The series kernel, e.g. acf or linear_detrend.
+ * @param data The input series, count blocks of n values.
+ * @param result The results, count blocks of n values.
+ * @param n The size of each series.
+ * @param count The number of series.
+ */
+HC_EXPORT
+void hc_batch(hc_series_kernel kernel, float* data, float* result, int n, int count) {
+    #pragma omp parallel for schedule(dynamic)
+    for (int s = 0; s < count; s++) {
+        kernel(data + (size_t)s * n, result + (size_t)s * n, n);
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * @brief Registry of the native kernels by name.
+ *
+ */
+#include "hc_registry.h"
+#include <math.h>
+#include <string.h>
+
+const hc_kernel_entry hc_kernels[] = {
+    {"acf", HC_KIND_SERIES, acf, NULL},
+    {"pacf", HC_KIND_SERIES, pacf, NULL},
+    {"linear_detrend", HC_KIND_SERIES, linear_detrend, NULL},
+    {"boxcox_transform", HC_KIND_SERIES, boxcox_transform, NULL},
+    {"arima_autoParams", HC_KIND_SERIES, arima_autoParams, NULL},
+    {"arima_setParams", HC_KIND_SERIES, arima_setParams, NULL},
+    {"monteCarlo_c", HC_KIND_MONTECARLO, monteCarlo_c, NULL},
+    {"matrixMultiply_c", HC_KIND_MATRIX, NULL, matrixMultiply_c},
+    {"matrixAddition_c", HC_KIND_MATRIX, NULL, matrixAddition_c},
+    {"bmm", HC_KIND_BLOCKED, NULL, NULL},
+    {NULL, HC_KIND_SERIES, NULL, NULL},
+};
+
+/**
+ * @brief Side of the two square matrices held one after the other in n values.
+ *
+ * @return The side, or 0 if n does not hold two square matrices.
+ */
+static size_t matrix_side(size_t n) {
+    size_t side = (size_t)llround(sqrt(n / 2.0));
+    return side > 0 && 2 * side * side == n ? side : 0;
+}
+
+const hc_kernel_entry* hc_find_kernel(const char* name) {
+    if (name[0] == '_') name++;
+    for (const hc_kernel_entry* k = hc_kernels; k->name != NULL; k++) {
+        if (strcmp(k->name, name) == 0) {
+            return k;
+        }
+    }
+    return NULL;
+}
+
+size_t hc_output_length(const hc_kernel_entry* kernel, size_t n) {
+    switch (kernel->kind) {
+    case HC_KIND_SERIES:
+        return n;
+    case HC_KIND_MONTECARLO:
+        return n > 0 ? HC_MC_SIMULATIONS : 0;
+    default: {
+        size_t side = matrix_side(n);
+        return side * side;
+    }
+    }
+}
+
+void hc_run_kernel(const hc_kernel_entry* kernel, float* data, float* result, size_t n, int block) {
+    switch (kernel->kind) {
+    case HC_KIND_SERIES:
+    case HC_KIND_MONTECARLO:
+        kernel->series(data, result, (int)n);
+        break;
+    case HC_KIND_MATRIX: {
+        size_t side = matrix_side(n);
+        kernel->matrix(data, data + side * side, result, (int)side);
+        break;
+    }
+    case HC_KIND_BLOCKED: {
+        size_t side = matrix_side(n);
+        bmm(data, data + side * side, result, (int)side, block);
+        break;
+    }
+    }
+}
@@ -0,0 +1,45 @@
+/**
+ * @brief Registry of the native kernels by name, shared by the command-line runner and the Node addon.
+ *
+ */
+#ifndef HC_REGISTRY_H
+#define HC_REGISTRY_H
+
+#include "hydrocompute.h"
+#include <stddef.h>
+
+/**
+ * @brief Shapes of the kernels.
+ */
+enum hc_kind {
+    HC_KIND_SERIES,     /* kernel(data, result, n) with n outputs */
+    HC_KIND_MONTECARLO, /* kernel(data, result, n) with HC_MC_SIMULATIONS outputs */
+    HC_KIND_MATRIX,     /* kernel(a, b, result, size) over two square matrices */
+    HC_KIND_BLOCKED     /* bmm(a, b, result, size, block) */
+};
+
+typedef void (*hc_matrix_kernel)(float*, float*, float*, int);
+
+/**
+ * @brief Kernel available by name.
+ */
+typedef struct {
+    const char* name;
+    enum hc_kind kind;
+    hc_series_kernel series;
+    hc_matrix_kernel matrix;
+} hc_kernel_entry;
+
+/* Kernels in the registry, terminated by an entry with a NULL name */
+extern const hc_kernel_entry hc_kernels[];
+
+/* Finds a kernel by name. A leading underscore, as in the wasm exports, is ignored */
+const hc_kernel_entry* hc_find_kernel(const char* name);
+
+/* Number of outputs of a kernel over n inputs, 0 if n is not a valid input size */
+size_t hc_output_length(const hc_kernel_entry* kernel, size_t n);
+
+/* Runs a kernel over n inputs into result, which holds hc_output_length values */
+void hc_run_kernel(const hc_kernel_entry* kernel, float* data, float* result, size_t n, int block);
+
+#endif
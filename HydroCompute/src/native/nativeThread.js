@@ -0,0 +1,155 @@
+import { isNode } from "../core/utils/runtime.js";
+import { FileNotFound, NotImplemented } from "../core/utils/errors.js";
+import { wallClock } from "../core/utils/globalUtils.js";
+import { hashFiles } from "../core/utils/memoize.js";
+
+/**
+ * @namespace native
+ * @description Native engine. Runs the C kernels of src/wasm/modules/C compiled for the host through the Node.js
+ * addon built in src/native (hydrocompute.node). The addon reads and writes the buffers of the engine in place and
+ * runs each kernel on the libuv threadpool, so no worker thread is started and no data is copied. Only available
+ * under Node.js.
+ */
+
+/**
+ * @description Locations searched for the addon, relative to this file. The HYDROCOMPUTE_ADDON environment variable
+ * takes precedence.
+ * @memberof native
+ */
+const addonLocations = ["./build/hydrocompute.node", "./build/Release/hydrocompute.node"];
+
+let addon = null,
+  addonLocation = null;
+
+/**
+ * @method loadAddon
+ * @memberof native
+ * @description Loads the addon the first time it is needed.
+ * @returns {Object} addon exports: run, runSync and kernels
+ */
+export const loadAddon = () => {
+  if (addon !== null) return addon;
+  if (!isNode) {
+    throw new NotImplemented("The native engine is only available under Node.js.");
+  }
+  const { createRequire } = process.getBuiltinModule("node:module"),
+    { existsSync } = process.getBuiltinModule("node:fs"),
+    { fileURLToPath } = process.getBuiltinModule("node:url"),
+    { resolve } = process.getBuiltinModule("node:path"),
+    require = createRequire(import.meta.url),
+    candidates = [
+      //Relative to the working directory, as any other path given on the command line
+      process.env.HYDROCOMPUTE_ADDON ? resolve(process.env.HYDROCOMPUTE_ADDON) : null,
+      ...addonLocations.map((location) => fileURLToPath(new URL(location, import.meta.url))),
+    ].filter((location) => location && existsSync(location));
+  if (candidates.length === 0) {
+    throw new FileNotFound(
+      "The native addon was not found. Build it in src/native or set HYDROCOMPUTE_ADDON to its location."
+    );
+  }
+  addon = require(candidates[0]);
+  addonLocation = candidates[0];
+  return addon;
+};
+
+/**
+ * @method nativeVersion
+ * @memberof native
+ * @description Version of the kernels of the engine, the hash of the addon binary they are compiled into.
+ * @returns {Promise<String>} hash of the addon
+ */
+export const nativeVersion = () => {
+  loadAddon();
+  const { pathToFileURL } = process.getBuiltinModule("node:url");
+  return hashFiles([pathToFileURL(addonLocation)]);
+};
+
+/**
+ * @method nativeScripts
+ * @memberof native
+ * @description Kernels available in the native engine, named as the functions of the C Web Assembly modules.
+ * @returns {Map<string, string[]>} - A map of the addon to its functions.
+ */
+export const nativeScripts = () =>
+  new Map([["native", loadAddon().kernels().map((name) => `_${name}`)]]);
+
+/**
+ * @class NativeThread
+ * @memberof native
+ * @description Worker interface over the addon, used by the thread manager in place of a worker for the native
+ * engine. A message runs one kernel over the data it carries and answers with the same fields as the workers of the
+ * other engines. Transferred buffers are read in place, as they are not shared with any other thread.
+ */
+export class NativeThread {
+  constructor() {
+    this.onmessage = null;
+    this.onerror = null;
+  }
+
+  /**
+   * @method postMessage
+   * @memberof native.NativeThread
+   * @param {Object} args - message of the thread manager, holding data, byteOffset, elementCount, funcName and funcArgs,
+   * and the OpenMP threads of the kernel, 0 for all the processors
+   */
+  postMessage(args) {
+    const start = performance.now(),
+      startScript = wallClock(),
+      { funcName, funcArgs, threads = 0 } = args,
+      [block] = Array.isArray(funcArgs) ? funcArgs : funcArgs !== undefined ? [funcArgs] : [],
+      options = typeof block === "number" ? { block, threads } : { threads },
+      data = new Float32Array(args.data, args.byteOffset || 0, args.elementCount);
+    let run, loadedScript;
+    try {
+      const addon = loadAddon();
+      loadedScript = wallClock();
+      run = addon.run(funcName, data, options);
+    } catch (error) {
+      run = Promise.reject(error);
+    }
+    run.then((result) => {
+      //The kernel is placed at the end of the call, the wait for a threadpool slot counts as transfer
+      const endScript = wallClock();
+      return this.onmessage
+        ? this.onmessage({
+            data: {
+              results: result.buffer,
+              funcName,
+              funcExec: result.elapsed,
+              workerExec: performance.now() - start,
+              marks: {
+                startScript,
+                loadedScript,
+                startFunction: endScript - result.elapsed,
+                endFunction: endScript,
+                endScript,
+              },
+              stats: {
+                status: result.status,
+                detail: result.statusDetail,
+                iterations: result.iterations,
+                converged: result.converged,
+                //The output allocated by the addon, inputs are read in place
+                allocations: 1,
+              },
+              //Scratch memory of the kernel, the input and output live in the JavaScript heap
+              memory: {
+                allocations: result.memory.allocations,
+                allocatedBytes: result.memory.bytes,
+                heapPeak: result.memory.peak,
+              },
+            },
+          })
+        : null;
+    },
+      (error) => (this.onerror ? this.onerror(error) : null)
+    );
+  }
+
+  /**
+   * @method terminate
+   * @memberof native.NativeThread
+   * @description Nothing to release, kernels finish on their own.
+   */
+  terminate() {}
+}
@@ -7,11 +7,12 @@
  * management functions for creating and destroying memory.
  *
  */
-#include <emscripten.h>
+#include "../hydrocompute.h"
 #include <math.h>
 #include <stdlib.h>
-#include <stdint.h>
+#ifdef HC_VERBOSE
 #include <stdio.h>
+#endif
 
 /**
  * @brief Allocates memory of a specified size.
@@ -19,9 +20,10 @@
  * @param size The size of the memory to allocate.
  * @return A pointer to the allocated memory.
  */
-EMSCRIPTEN_KEEPALIVE
-uint8_t* createMem(int size) {
-	return malloc(size);
+#ifndef HC_SHARED_ALLOCATOR
+HC_EXPORT
+uint8_t* createMem(size_t size) {
+	return hc_malloc(size);
 }
 
 /**
@@ -29,11 +31,84 @@ uint8_t* createMem(int size) {
  *
  * @param p A pointer to the memory to be deallocated.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 void destroy(uint8_t* p){
-	free(p);
+	hc_free(p);
 }
 
+/**
+ * @brief Size of the pointers of the build, 8 in Memory64 builds.
+ *
+ * @return The size of a pointer in bytes.
+ */
+HC_EXPORT
+int hc_pointer_size(void) {
+	return (int)sizeof(void*);
+}
+
+static hc_stats stats = {HC_OK, 0, 0, 0};
+
+/**
+ * @brief Records the outcome of a kernel call.
+ *
+ * @param code The status code.
+ * @param detail The detail of the status.
+ */
+void hc_set_status(int code, int detail) {
+	stats.status = code;
+	stats.detail = detail;
+}
+
+/**
+ * @brief Records the iterations run by an iterative kernel.
+ *
+ * @param iterations The iterations run.
+ * @param converged 1 if the kernel reached its tolerance, 0 otherwise.
+ */
+void hc_set_iterations(int iterations, int converged) {
+	stats.iterations = iterations;
+	stats.converged = converged;
+}
+
+/**
+ * @brief Clears the statistics before a kernel call.
+ */
+HC_EXPORT
+void hc_reset_stats(void) {
+	stats = (hc_stats){HC_OK, 0, 0, 0};
+}
+
+/**
+ * @brief Statistics of the last kernel call.
+ *
+ * @return A pointer to the status, detail, iterations and convergence flag of the call.
+ */
+HC_EXPORT
+const hc_stats* hc_last_stats(void) {
+	return &stats;
+}
+
+/**
+ * @brief Status of the last kernel call.
+ *
+ * @return HC_OK, HC_NOT_CONVERGED or HC_OUT_OF_MEMORY.
+ */
+HC_EXPORT
+int hc_status(void) {
+	return stats.status;
+}
+
+/**
+ * @brief Detail of the status of the last kernel call.
+ *
+ * @return The iterations to converge for arima_autoParams, or the optimal lag for pacf.
+ */
+HC_EXPORT
+int hc_status_detail(void) {
+	return stats.detail;
+}
+#endif
+
 /**
  * @brief Performs linear detrending on the input data.
  *
@@ -41,7 +116,7 @@ void destroy(uint8_t* p){
  * @param result The detrended data.
  * @param n The size of the data.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 void linear_detrend(float *data, float *result, int n) {
     float x_mean = 0.0;
     float y_mean = 0.0;
@@ -80,7 +155,7 @@ void linear_detrend(float *data, float *result, int n) {
  * @param prediction The predicted data.
  * @param n The size of the data.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 // autoupdate parameter ARMA model
 void arima_autoParams(float *data, float *prediction, int n) {
     int MAX_ITERATIONS = 1000;
@@ -89,6 +164,9 @@ void arima_autoParams(float *data, float *prediction, int n) {
     float theta = -0.2; // MA coefficient
     float mu = 0.0; // Mean
 
+    hc_set_status(HC_NOT_CONVERGED, MAX_ITERATIONS);
+    hc_set_iterations(MAX_ITERATIONS, 0);
+
     // Calculate the mean of the data
     for (int i = 0; i < n; i++) {
         mu += data[i];
@@ -98,7 +176,6 @@ void arima_autoParams(float *data, float *prediction, int n) {
     for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++) {
         float prev_phi = phi;
         float prev_theta = theta;
-        float prev_mu = mu;
         float sum_xy = 0.0;
         float sum_x_sq = 0.0;
         float sum_error_sq = 0.0;
@@ -119,7 +196,11 @@ void arima_autoParams(float *data, float *prediction, int n) {
         float diff_theta = theta - prev_theta;
         float diff_norm = sqrt(diff_phi * diff_phi + diff_theta * diff_theta);
         if (diff_norm < TOLERANCE) {
+            hc_set_status(HC_OK, iteration + 1);
+            hc_set_iterations(iteration + 1, 1);
+#ifdef HC_VERBOSE
             printf("Converged after %d iterations\n", iteration + 1);
+#endif
             break;
         }
     }
@@ -138,12 +219,10 @@ void arima_autoParams(float *data, float *prediction, int n) {
  * @param prediction The predicted data.
  * @param m The size of the data.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 // autoupdate parameter ARMA model
 void arima_setParams(float *data, float *prediction, int m) {
 	int n = m / sizeof(data[0]);
-	int MAX_ITERATIONS = 1000;
-	float TOLERANCE = 1e-6;
     // Initial guesses for model parameters
     float phi = 0.5; // AR coefficient
     float theta = 0.2; // MA coefficient
@@ -169,7 +248,7 @@ void arima_setParams(float *data, float *prediction, int m) {
  * @param result The computed ACF.
  * @param n The size of the data.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 // total autocorrelation function
 void acf(float *data, float *result, int n) {
     int i, j;
@@ -185,7 +264,8 @@ void acf(float *data, float *result, int n) {
     }
     var /= n;
 
-    // Compute autocorrelation function
+    // Compute autocorrelation function. Lags are independent, later ones are shorter
+    #pragma omp parallel for private(j) schedule(dynamic, 64)
     for (i = 0; i < n; i++) {
         float ac = 0;
         for (j = i; j < n; j++) {
@@ -205,13 +285,18 @@ void acf(float *data, float *result, int n) {
  * @param pacf_result The computed PACF.
  * @param n The size of the data.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 // partial autocorrelation function with max lag of 75
 void pacf(float *x, float *pacf_result, int n) {
     int i, j, k;
-    float r[n];
-    float phi[n];
-    float aic[n];
+    // Work arrays on the heap, series can be larger than the stack of a thread
+    float *r = hc_malloc(3 * (size_t)n * sizeof(float));
+    if (r == NULL) {
+        hc_set_status(HC_OUT_OF_MEMORY, 0);
+        return;
+    }
+    float *phi = r + n;
+    float *aic = phi + n;
 
     for (i = 0; i < n; i++) {
         r[i] = x[i];
@@ -265,7 +350,10 @@ void pacf(float *x, float *pacf_result, int n) {
         }
     }
 
+    hc_set_status(HC_OK, max_lag);
+#ifdef HC_VERBOSE
     printf("Optimal maximum lag based on AIC: %d\n", max_lag);
+#endif
 
     for (k = 0; k <= max_lag; k++) {
         float num = 0.0;
@@ -294,6 +382,7 @@ void pacf(float *x, float *pacf_result, int n) {
             pacf_result[k] -= phi[j] * pacf_result[k-j-1];
         }
     }
+    hc_free(r);
 }
 
 /**
@@ -303,7 +392,7 @@ void pacf(float *x, float *pacf_result, int n) {
  * @param result The transformed data.
  * @param n The size of the data.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 void boxcox_transform(float* data, float* result, int n) {
 	float lambda = 0.5;
     // Iterate over each data point
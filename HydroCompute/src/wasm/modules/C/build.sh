@@ -0,0 +1,147 @@
+#!/usr/bin/env bash
+# Builds the C modules of the Web Assembly engine.
+#
+#   ./build.sh [profile] [module...]
+#
+# Profiles:
+#   emscripten  ES6 module with the Emscripten runtime, loaded by the browser and Node.js workers (default)
+#   minimal     bare module without filesystem, stdio or runtime glue, optimized for size and instantiated
+#               by the shared loader in modules/standalone.js (<module>/<module>.min.wasm)
+#   wasi        standalone WASI reactor exporting only memory and the functions marked with HC_EXPORT,
+#               run under the wasi module of Node.js (<module>/<module>.wasi.wasm)
+#   memory64    ES6 module with the Emscripten runtime and 64-bit pointers, for inputs beyond the 4 GB wasm32 heap
+#               on runtimes supporting Memory64 (<module>/<module>.m64.js)
+#   snapshot    wasi build of the modules with precomputed tables, pre-initialized with Wizer: hc_initialize
+#               runs once at build time and its memory is saved into the data segments of the binary
+#   profiling   ES6 module with the Emscripten runtime keeping the names of the C functions, without inlining
+#               the static helpers, for the sampling profiler in bench/profile.js (<module>/<module>.prof.js)
+#
+# The emscripten and profiling builds also write a symbol map (<module>.js.symbols), mapping the function indices of
+# the binary to the C names, used to name the frames of the minified builds in profiles.
+#
+# HC_INITIAL_MEMORY sets the initial heap of the modules (e.g. HC_INITIAL_MEMORY=64MB), sized from the heap peaks
+# reported in the results so that kernels do not stall on memory.grow.
+#
+# Modules default to all of them. Requires emcc on the path (see emscripten.conf and the Dockerfile), and uses
+# wasm-opt from binaryen when available. builds.json lists the builds found for each module, and is read by the
+# engine to pick the lightest build available, along with the hash of the binaries of each module, which versions the
+# memoized results of its kernels.
+set -euo pipefail
+
+cd "$(dirname "$0")"
+
+profile="${1:-emscripten}"
+[ $# -gt 0 ] && shift
+
+# module:source[:initialize], where initialize marks the modules with tables to precompute in hc_initialize.
+# The exports of every profile are the functions marked with HC_EXPORT in the sources (see hydrocompute.h).
+MODULES=(
+  "arima_c:arima_c.c"
+  "matrixUtils_c:matrixUtils_c.c"
+  "monteCarlo_c:monteCarlo.c:initialize"
+)
+
+selected=("$@")
+initial=()
+[ -n "${HC_INITIAL_MEMORY:-}" ] && initial=(-s INITIAL_MEMORY="$HC_INITIAL_MEMORY")
+
+build_module() {
+  local name="$1" source="$2" initialize="$3"
+  case "$profile" in
+    emscripten)
+      emcc "$name/$source" hc_memory.c -I. -O3 -o "$name/$name.js" \
+        -s MODULARIZE -s EXPORT_ES6=1 -s ALLOW_MEMORY_GROWTH=1 "${initial[@]}" --emit-symbol-map
+      ;;
+    profiling)
+      # The name section is kept in the binary, so V8 reports the C names in its CPU profiles
+      emcc "$name/$source" hc_memory.c -I. -O2 -fno-inline-functions -o "$name/$name.prof.js" \
+        -s MODULARIZE -s EXPORT_ES6=1 -s ALLOW_MEMORY_GROWTH=1 "${initial[@]}" --profiling-funcs --emit-symbol-map
+      ;;
+    memory64)
+      emcc "$name/$source" hc_memory.c -I. -O3 -o "$name/$name.m64.js" \
+        -s MODULARIZE -s EXPORT_ES6=1 -s ALLOW_MEMORY_GROWTH=1 "${initial[@]}" \
+        -s MEMORY64=1 -s MAXIMUM_MEMORY=16GB
+      ;;
+    minimal)
+      emcc "$name/$source" hc_memory.c -I. -Oz -o "$name/$name.min.wasm" \
+        -s STANDALONE_WASM=1 -s FILESYSTEM=0 -s ALLOW_MEMORY_GROWTH=1 "${initial[@]}" --no-entry
+      if command -v wasm-opt > /dev/null; then
+        wasm-opt -Oz --strip-debug --strip-producers "$name/$name.min.wasm" -o "$name/$name.min.wasm"
+      fi
+      ;;
+    wasi|snapshot)
+      # PURE_WASI drops the Emscripten imports, so the only host interface left is wasi_snapshot_preview1
+      emcc "$name/$source" hc_memory.c -I. -O3 -o "$name/$name.wasi.wasm" \
+        -s PURE_WASI=1 -s ALLOW_MEMORY_GROWTH=1 "${initial[@]}" --no-entry
+      if [ "$profile" = snapshot ] && [ "$initialize" = initialize ]; then
+        wizer "$name/$name.wasi.wasm" --allow-wasi --init-func hc_initialize -o "$name/$name.wasi.wasm"
+      fi
+      ;;
+    *)
+      echo "Unknown profile: $profile" >&2
+      exit 1
+      ;;
+  esac
+  echo "Built $name ($profile)"
+}
+
+# Bytes loaded by each worker per build: the glue script and the binary
+report_sizes() {
+  local name="$1"
+  for file in "$name/$name.js" "$name/$name.wasm" "$name/$name.m64.js" "$name/$name.m64.wasm" \
+    "$name/$name.min.wasm" "$name/$name.wasi.wasm" "$name/$name.prof.js" "$name/$name.prof.wasm"; do
+    [ -f "$file" ] && printf "  %-32s %8d bytes\n" "$file" "$(wc -c < "$file")"
+  done
+  return 0
+}
+
+# sha256 of the binaries built for a module, the version of its kernels in the keys of memoized results
+module_hash() {
+  local name="$1"
+  if command -v sha256sum > /dev/null; then
+    cat "$name"/*.wasm 2> /dev/null | sha256sum | cut -d' ' -f1
+  else
+    cat "$name"/*.wasm 2> /dev/null | shasum -a 256 | cut -d' ' -f1
+  fi
+}
+
+write_manifest() {
+  local first=1
+  {
+    echo "{"
+    for entry in "${MODULES[@]}"; do
+      IFS=: read -r name _ _ <<< "$entry"
+      local found=()
+      [ -f "$name/$name.js" ] && found+=("\"emscripten\"")
+      [ -f "$name/$name.m64.js" ] && found+=("\"memory64\"")
+      [ -f "$name/$name.min.wasm" ] && found+=("\"minimal\"")
+      [ -f "$name/$name.wasi.wasm" ] && found+=("\"wasi\"")
+      [ -f "$name/$name.prof.js" ] && found+=("\"profiling\"")
+      [ $first -eq 1 ] || echo ","
+      first=0
+      printf '  "%s": [%s]' "$name" "$(IFS=,; echo "${found[*]}")"
+    done
+    echo ","
+    echo '  "hashes": {'
+    first=1
+    for entry in "${MODULES[@]}"; do
+      IFS=: read -r name _ _ <<< "$entry"
+      [ $first -eq 1 ] || echo ","
+      first=0
+      printf '    "%s": "%s"' "$name" "$(module_hash "$name")"
+    done
+    echo
+    echo "  }"
+    echo "}"
+  } > builds.json
+}
+
+for entry in "${MODULES[@]}"; do
+  IFS=: read -r name source initialize <<< "$entry"
+  if [ ${#selected[@]} -eq 0 ] || [[ " ${selected[*]} " == *" $name "* ]]; then
+    build_module "$name" "$source" "$initialize"
+    report_sizes "$name"
+  fi
+done
+
+write_manifest
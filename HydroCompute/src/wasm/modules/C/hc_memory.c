@@ -0,0 +1,106 @@
+/**
+ * @brief Memory accounting of the HydroCompute C kernels.
+ *
+ * The allocators of the modules (createMem and destroy) and the scratch memory of the kernels go through
+ * hc_malloc and hc_free, which count the allocations and keep the live and peak bytes. In Web Assembly builds
+ * the deepest stack use of a call is measured by painting the free stack before it and finding the lowest
+ * overwritten byte after it. The engines read both through hc_last_memory to size the heap of the modules.
+ *
+ * Compiled into every Emscripten module and into the native libraries, where the counters are kept per thread.
+ */
+#include "hydrocompute.h"
+#include <stdlib.h>
+#ifdef __EMSCRIPTEN__
+#include <emscripten/stack.h>
+#define HC_THREAD_LOCAL
+#else
+#define HC_THREAD_LOCAL _Thread_local
+#endif
+
+/* Size of the block header, keeping the alignment malloc guarantees */
+#define HC_HEADER 16
+#define HC_STACK_PAINT 0xA5
+/* Bytes left unpainted below the frame of hc_stack_paint */
+#define HC_STACK_MARGIN 256
+
+static HC_THREAD_LOCAL hc_memory_stats memory = {0, 0, 0, 0, 0};
+
+/**
+ * @brief Allocates memory, recording its size in front of the block.
+ *
+ * @param size The size of the memory to allocate.
+ * @return A pointer to the allocated memory, or NULL.
+ */
+void* hc_malloc(size_t size) {
+	uint8_t* block = malloc(size + HC_HEADER);
+	if (block == NULL) return NULL;
+	*(size_t*)block = size;
+	memory.allocations += 1;
+	memory.bytes += (int64_t)size;
+	memory.live += (int64_t)size;
+	if (memory.live > memory.peak) memory.peak = memory.live;
+	return block + HC_HEADER;
+}
+
+/**
+ * @brief Deallocates memory allocated with hc_malloc.
+ *
+ * @param p A pointer returned by hc_malloc, or NULL.
+ */
+void hc_free(void* p) {
+	if (p == NULL) return;
+	uint8_t* block = (uint8_t*)p - HC_HEADER;
+	memory.live -= (int64_t)*(size_t*)block;
+	free(block);
+}
+
+/**
+ * @brief Starts a new measurement. Memory still allocated counts towards the peak.
+ */
+HC_EXPORT
+void hc_memory_reset(void) {
+	memory.allocations = 0;
+	memory.bytes = 0;
+	memory.peak = memory.live;
+	memory.stack_peak = 0;
+}
+
+/**
+ * @brief Memory used since the last hc_memory_reset on the calling thread.
+ *
+ * @return A pointer to the allocations, bytes, live and peak bytes, and stack peak.
+ */
+HC_EXPORT
+const hc_memory_stats* hc_last_memory(void) {
+	return &memory;
+}
+
+/**
+ * @brief Fills the free part of the stack with a pattern before a call. Wasm builds only.
+ */
+HC_EXPORT
+void hc_stack_paint(void) {
+#ifdef __EMSCRIPTEN__
+	volatile uint8_t* end = (uint8_t*)emscripten_stack_get_end();
+	volatile uint8_t* current = (uint8_t*)emscripten_stack_get_current() - HC_STACK_MARGIN;
+	for (volatile uint8_t* p = end; p < current; p++) *p = HC_STACK_PAINT;
+#endif
+}
+
+/**
+ * @brief Measures the deepest stack use since hc_stack_paint and records it. Wasm builds only.
+ *
+ * @return The stack used in bytes, 0 if it cannot be measured.
+ */
+HC_EXPORT
+int hc_stack_peak(void) {
+#ifdef __EMSCRIPTEN__
+	volatile uint8_t* end = (uint8_t*)emscripten_stack_get_end();
+	volatile uint8_t* base = (uint8_t*)emscripten_stack_get_base();
+	volatile uint8_t* p = end;
+	//The stack grows down, the first byte off the pattern is the deepest one written
+	while (p < base && *p == HC_STACK_PAINT) p++;
+	memory.stack_peak = (int64_t)(base - p);
+#endif
+	return (int)memory.stack_peak;
+}
@@ -0,0 +1,107 @@
+/**
+ * @brief Shared declarations of the HydroCompute C kernels.
+ *
+ * The same sources are compiled into Web Assembly with Emscripten and into the native libraries
+ * (see src/native). Exported functions are marked with HC_EXPORT, which keeps them alive and exported in
+ * every profile of the Emscripten modules (see build.sh) and gives them default visibility in the native shared
+ * library.
+ *
+ * Each Emscripten module carries its own createMem/destroy pair and status word. Builds linking several
+ * kernel files together define HC_SHARED_ALLOCATOR and provide them once instead.
+ *
+ * Kernels do not print. Diagnostics are reported through the status of the last call, so the modules build
+ * without stdio. Defining HC_VERBOSE prints them as well, for debugging.
+ */
+#ifndef HYDROCOMPUTE_H
+#define HYDROCOMPUTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#define HC_EXPORT EMSCRIPTEN_KEEPALIVE
+#elif defined(_WIN32)
+#define HC_EXPORT __declspec(dllexport)
+#else
+#define HC_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Memory management. Sizes and pointers are 64-bit in Memory64 builds, and BigInts on the JavaScript side */
+HC_EXPORT uint8_t* createMem(size_t size);
+HC_EXPORT void destroy(uint8_t* p);
+HC_EXPORT int hc_pointer_size(void);
+
+/* Status of the last kernel call on the calling thread */
+#define HC_OK 0
+#define HC_NOT_CONVERGED 1
+#define HC_OUT_OF_MEMORY 2
+
+HC_EXPORT int hc_status(void);
+/* Detail of the last status: iterations to converge for arima_autoParams, optimal lag for pacf */
+HC_EXPORT int hc_status_detail(void);
+void hc_set_status(int status, int detail);
+
+/* Statistics of the last kernel call on the calling thread, read by the engines after each call */
+typedef struct {
+    int32_t status;     /* HC_OK, HC_NOT_CONVERGED or HC_OUT_OF_MEMORY */
+    int32_t detail;     /* see hc_status_detail */
+    int32_t iterations; /* iterations run by iterative kernels, 0 for the others */
+    int32_t converged;  /* 1 if an iterative kernel reached its tolerance */
+} hc_stats;
+
+HC_EXPORT const hc_stats* hc_last_stats(void);
+HC_EXPORT void hc_reset_stats(void);
+void hc_set_iterations(int iterations, int converged);
+
+/* Memory used by the kernels since the last hc_memory_reset on the calling thread, see hc_memory.c */
+typedef struct {
+    int64_t allocations; /* calls to hc_malloc, including createMem */
+    int64_t bytes;       /* bytes requested by them */
+    int64_t live;        /* bytes allocated and not freed yet */
+    int64_t peak;        /* highest live bytes */
+    int64_t stack_peak;  /* deepest stack use measured by hc_stack_peak, wasm builds only */
+} hc_memory_stats;
+
+void* hc_malloc(size_t size);
+void hc_free(void* p);
+HC_EXPORT void hc_memory_reset(void);
+HC_EXPORT const hc_memory_stats* hc_last_memory(void);
+HC_EXPORT void hc_stack_paint(void);
+HC_EXPORT int hc_stack_peak(void);
+
+/* Precomputes the tables of a module before the first kernel call. Idempotent, and already done in snapshot builds */
+HC_EXPORT void hc_initialize(void);
+void hc_monteCarlo_initialize(void);
+
+/* Series kernels: data and result hold n values */
+typedef void (*hc_series_kernel)(float* data, float* result, int n);
+
+HC_EXPORT void linear_detrend(float* data, float* result, int n);
+HC_EXPORT void arima_autoParams(float* data, float* prediction, int n);
+HC_EXPORT void arima_setParams(float* data, float* prediction, int m);
+HC_EXPORT void acf(float* data, float* result, int n);
+HC_EXPORT void pacf(float* x, float* pacf_result, int n);
+HC_EXPORT void boxcox_transform(float* data, float* result, int n);
+
+/* Monte Carlo peak flow simulation, result holds HC_MC_SIMULATIONS values */
+#define HC_MC_SIMULATIONS 10000
+HC_EXPORT void monteCarlo_c(float* data, float* result, int n);
+
+/* Matrix kernels over square matrices of side size */
+HC_EXPORT void matrixAddition_c(float* matrix1, float* matrix2, float* result, int size);
+HC_EXPORT void matrixMultiply_c(float* matrix1, float* matrix2, float* result, int size);
+HC_EXPORT void bmm(float* matrixA, float* matrixB, float* matrixC, int length, int blockSize);
+
+/* Native library only: runs a series kernel over count contiguous series of n values in parallel */
+HC_EXPORT void hc_batch(hc_series_kernel kernel, float* data, float* result, int n, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
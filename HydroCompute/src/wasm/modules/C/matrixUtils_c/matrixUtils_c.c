@@ -7,11 +7,12 @@
  *
  */
 
-#include <emscripten.h>
+#include "../hydrocompute.h"
+#ifdef __EMSCRIPTEN__
 #include <sanitizer/lsan_interface.h>
+#endif
 #include <math.h>
 #include <stdlib.h>
-#include <stdint.h>
 
 /**
  * @brief Allocates memory of a specified size.
@@ -19,9 +20,10 @@
  * @param size The size of the memory to allocate.
  * @return A pointer to the allocated memory.
  */
-EMSCRIPTEN_KEEPALIVE
-uint8_t* createMem(int size) {
-	return malloc(size);
+#ifndef HC_SHARED_ALLOCATOR
+HC_EXPORT
+uint8_t* createMem(size_t size) {
+	return hc_malloc(size);
 }
 
 /**
@@ -29,11 +31,22 @@ uint8_t* createMem(int size) {
  *
  * @param p A pointer to the memory to be deallocated.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 void destroy(uint8_t* p){
-	free(p);
+	hc_free(p);
 }
 
+/**
+ * @brief Size of the pointers of the build, 8 in Memory64 builds.
+ *
+ * @return The size of a pointer in bytes.
+ */
+HC_EXPORT
+int hc_pointer_size(void) {
+	return (int)sizeof(void*);
+}
+#endif
+
 /**
  * @brief Performs matrix addition.
  *
@@ -42,8 +55,9 @@ void destroy(uint8_t* p){
  * @param result The matrix to store the addition result.
  * @param size The size of the matrices.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 void matrixAddition_c(float *matrix1, float *matrix2, float* result, int size) {
+  #pragma omp parallel for simd
   for (int i = 0; i < size; i++) {
     result[i] = matrix1[i] + matrix2[i];
   }
@@ -57,13 +71,22 @@ void matrixAddition_c(float *matrix1, float *matrix2, float* result, int size) {
  * @param result The matrix to store the multiplication result.
  * @param size The size of the matrices.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 void matrixMultiply_c(float* matrix1, float* matrix2, float* result, int size) {
+    // Rows of the result are independent. The k-j order streams through contiguous rows of
+    // matrix2 and the result so the inner loop vectorizes, summing over k in the same order.
+    #pragma omp parallel for
     for (int i = 0; i < size; i++) {
+        float* row = result + (size_t)i * size;
         for (int j = 0; j < size; j++) {
-            result[i * size + j] = 0.0;
-            for (int k = 0; k < size; k++) {
-                result[i * size + j] += matrix1[i * size + k] * matrix2[k * size + j];
+            row[j] = 0.0;
+        }
+        for (int k = 0; k < size; k++) {
+            float a = matrix1[(size_t)i * size + k];
+            float* b = matrix2 + (size_t)k * size;
+            #pragma omp simd
+            for (int j = 0; j < size; j++) {
+                row[j] += a * b[j];
             }
         }
     }
@@ -78,20 +101,29 @@ void matrixMultiply_c(float* matrix1, float* matrix2, float* result, int size) {
  * @param length The size of the matrices.
  * @param blockSize The size of each block in the block matrix multiplication.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 void bmm(float* matrixA, float* matrixB, float* matrixC, int length, int blockSize) {
-  int block = blockSize * (length/blockSize);
-  double sum;
-  for (int kk = 0; kk < block; kk += blockSize) {
-    for (int jj = 0; jj < block; jj += blockSize) {
+  if (blockSize <= 0) {
+    blockSize = length;
+  }
+  // Each tile of columns is owned by a single thread, which accumulates every block of k into it
+  #pragma omp parallel for schedule(static)
+  for (int jj = 0; jj < length; jj += blockSize) {
+    int jEnd = jj + blockSize < length ? jj + blockSize : length;
+    for (int i = 0; i < length; i++) {
+      for (int j = jj; j < jEnd; j++) {
+        matrixC[(size_t)i * length + j] = 0.0;
+      }
+    }
+    for (int kk = 0; kk < length; kk += blockSize) {
+      int kEnd = kk + blockSize < length ? kk + blockSize : length;
       for (int i = 0; i < length; i++) {
-        for (int j = jj; j < jj + blockSize; j++) {
-		  sum = 0.0;
-          matrixC[i * length + j] = 0.0;
-          for (int k = kk; k < kk + blockSize; k++) {
-            sum += matrixA[i * length + k] * matrixB[k * length + j];
+        for (int j = jj; j < jEnd; j++) {
+          double sum = 0.0;
+          for (int k = kk; k < kEnd; k++) {
+            sum += matrixA[(size_t)i * length + k] * matrixB[(size_t)k * length + j];
           }
-          matrixC[i * length + j] += sum;
+          matrixC[(size_t)i * length + j] += sum;
         }
       }
     }
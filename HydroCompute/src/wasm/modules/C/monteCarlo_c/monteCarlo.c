@@ -7,14 +7,16 @@
  * calculates the peak flow for each simulation.
  *
  */
-#include <emscripten.h>
-#include <stdio.h>
+#include "../hydrocompute.h"
 #include <stdlib.h>
-#include <time.h>
 #include <math.h>
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
 #define DAYS_IN_YEAR 365
-#define NUM_OF_SIMULATIONS 10000
+#define NUM_OF_SIMULATIONS HC_MC_SIMULATIONS
 
 
 /**
@@ -23,9 +25,10 @@
  * @param size The size of the memory to allocate.
  * @return A pointer to the allocated memory.
  */
-EMSCRIPTEN_KEEPALIVE
-uint8_t* createMem(int size) {
-	return malloc(size);
+#ifndef HC_SHARED_ALLOCATOR
+HC_EXPORT
+uint8_t* createMem(size_t size) {
+	return hc_malloc(size);
 }
 
 /**
@@ -33,10 +36,21 @@ uint8_t* createMem(int size) {
  *
  * @param p A pointer to the memory to be deallocated.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 void destroy(uint8_t* p){
-	free(p);
+	hc_free(p);
+}
+
+/**
+ * @brief Size of the pointers of the build, 8 in Memory64 builds.
+ *
+ * @return The size of a pointer in bytes.
+ */
+HC_EXPORT
+int hc_pointer_size(void) {
+	return (int)sizeof(void*);
 }
+#endif
 
 /**
  * @brief Calculates the mean of a given array of floats.
@@ -45,7 +59,7 @@ void destroy(uint8_t* p){
  * @param n The size of the array.
  * @return The mean of the array.
  */
-float calculate_mean(float data[], int n) {
+static float calculate_mean(float data[], int n) {
     float sum = 0.0;
     for (int i = 0; i < n; i++) {
         sum += data[i];
@@ -61,7 +75,7 @@ float calculate_mean(float data[], int n) {
  * @param mean The mean of the array.
  * @return The standard deviation of the array.
  */
-float calculate_std_dev(float data[], int n, float mean) {
+static float calculate_std_dev(float data[], int n, float mean) {
     float sum = 0.0;
     for (int i = 0; i < n; i++) {
         sum += pow(data[i] - mean, 2);
@@ -70,39 +84,90 @@ float calculate_std_dev(float data[], int n, float mean) {
 }
 
 /**
- * @brief Generates random variates based on mean and standard deviation.
+ * @brief Returns the next uniform number in (0, 1] of a xorshift32 stream.
  *
- * @param mean The mean for random variate generation.
- * @param std_dev The standard deviation for random variate generation.
- * @param n The number of random variates to generate.
- * @param variates An array to store the generated random variates.
+ * Every simulation owns its stream, so simulations can run on any number of threads
+ * and still give the same results.
+ *
+ * @param state The state of the stream, never zero.
+ * @return The uniform number.
  */
-void generate_random_variates(float mean, float std_dev, int n, float variates[]) {
+static float next_uniform(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (float)((x >> 8) + 1) / 16777216.0f;
+}
+
+/**
+ * @brief Seeds the stream of a simulation.
+ *
+ * @param simulation The index of the simulation.
+ * @return A non-zero state.
+ */
+static uint32_t seed_stream(uint32_t simulation) {
+    uint32_t x = simulation * 0x9E3779B9u + 0x7F4A7C15u;
+    x = (x ^ (x >> 16)) * 0x85EBCA6Bu;
+    x = (x ^ (x >> 13)) * 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x != 0 ? x : 1;
+}
+
+/**
+ * @brief Draws the standard normal variates of a simulation and returns the largest.
+ *
+ * @param state The random stream of the simulation.
+ * @param n The number of variates to draw.
+ * @return The largest variate.
+ */
+static float peak_variate(uint32_t* state, int n) {
+    float peak = -INFINITY;
     for (int i = 0; i < n; i++) {
-        float u = (float)rand() / (float)RAND_MAX;
+        float u = next_uniform(state);
         float z = sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * u);
-        float x = mean + std_dev * z;
-        variates[i] = x;
+        if (z > peak) {
+            peak = z;
+        }
     }
+    return peak;
 }
 
+/*
+ * Largest standard variate drawn by each simulation over a year. The streams do not depend on the data, and
+ * mean + std_dev * z rounds monotonically in z for a non-negative std_dev, so the peak flow of a simulation is
+ * given by its largest variate alone. Filled once by hc_monteCarlo_initialize.
+ */
+static float peak_variates[NUM_OF_SIMULATIONS];
+static int initialized = 0;
+
 /**
- * @brief Calculates the peak flow from an array of variates.
+ * @brief Precomputes the tables of the module, drawing every variate of every simulation.
  *
- * @param variates The array of random variates.
- * @param n The size of the array.
- * @return The calculated peak flow.
+ * Runs at build time in snapshot builds, where the filled tables and the initialized flag are stored in the
+ * data segments of the binary, and on the first call otherwise. Calling it again does nothing.
  */
-float calculate_peak_flow(float variates[], int n) {
-    float max_flow = 0.0;
-    for (int i = 0; i < n; i++) {
-        if (variates[i] > max_flow) {
-            max_flow = variates[i];
-        }
+void hc_monteCarlo_initialize(void) {
+    if (initialized) return;
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < NUM_OF_SIMULATIONS; i++) {
+        uint32_t state = seed_stream((uint32_t)i);
+        peak_variates[i] = peak_variate(&state, DAYS_IN_YEAR);
     }
-    return max_flow;
+    initialized = 1;
 }
 
+#ifndef HC_SHARED_ALLOCATOR
+/**
+ * @brief Initializes the module, see hc_monteCarlo_initialize.
+ */
+HC_EXPORT
+void hc_initialize(void) {
+    hc_monteCarlo_initialize();
+}
+#endif
+
 /**
  * @brief Runs the Monte Carlo simulation for peak flow estimation.
  *
@@ -111,16 +176,18 @@ float calculate_peak_flow(float variates[], int n) {
  * @param num_simulations The number of Monte Carlo simulations to perform.
  * @param result An array to store the results of the simulations.
  */
-void run_monte_carlo_simulation(float data[], int n, int num_simulations, float result[]) {
+static void run_monte_carlo_simulation(float data[], int n, int num_simulations, float result[]) {
+    // Modules loaded from a snapshot start with the table in place
+    if (!initialized) {
+        hc_monteCarlo_initialize();
+    }
     float mean = calculate_mean(data, n);
     float std_dev = calculate_std_dev(data, n, mean);
-    float variates[DAYS_IN_YEAR];
-    float peak_flow;
 
+    // The peak flow of each simulation is never below zero
     for (int i = 0; i < num_simulations; i++) {
-        generate_random_variates(mean, std_dev, DAYS_IN_YEAR, variates);
-        peak_flow = calculate_peak_flow(variates, DAYS_IN_YEAR);
-        result[i] = peak_flow;
+        float peak = mean + std_dev * peak_variates[i];
+        result[i] = peak > 0.0f ? peak : 0.0f;
     }
 }
 
@@ -131,7 +198,7 @@ void run_monte_carlo_simulation(float data[], int n, int num_simulations, float
  * @param result An array to store the results of the simulations.
  * @param n The size of the data array.
  */
-EMSCRIPTEN_KEEPALIVE
+HC_EXPORT
 void monteCarlo_c(float *data, float *result, int n) {
     // convert data from float to double
     float result_float[NUM_OF_SIMULATIONS];
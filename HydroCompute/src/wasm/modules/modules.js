@@ -1,5 +1,9 @@
 import { CUtils } from "./C/mods.js";
 import { ASUtils } from "./assemblyScript/mods.js";
+import { isNode, readBinary } from "../../core/utils/runtime.js";
+import { WASIModule } from "./wasi.js";
+import { MinimalModule, availableBuilds } from "./standalone.js";
+import { hashContent, hashFiles } from "../../core/utils/memoize.js";
 
 /**
  * @namespace WASMUtils
@@ -78,8 +82,8 @@ const ASModule = async (name) => {
     //   }
     // );
 
-    const response = await fetch(_location("AS", name));
-    const buffer = await response.arrayBuffer();
+    //Read from disk under Node.js, where fetch does not support file URLs
+    const buffer = await readBinary(_location("AS", name));
     const module = await WebAssembly.instantiate(buffer,     
         {
           js: { mem: memory },
@@ -97,16 +101,54 @@ const ASModule = async (name) => {
 };
 
 /**
- * @description Asynchronously loads and creates a module from a C script.
+ * @description True if the runtime can instantiate Memory64 modules. Validates a module declaring a 64-bit memory.
+ * @memberof WASMUtils
+ */
+const memory64Supported = (() => {
+  try {
+    return WebAssembly.validate(new Uint8Array([0, 97, 115, 109, 1, 0, 0, 0, 5, 3, 1, 4, 1]));
+  } catch {
+    return false;
+  }
+})();
+
+/**
+ * @description Asynchronously loads and creates a module from a C script. Builds without the Emscripten runtime are
+ * preferred when they have been compiled: the WASI build under Node.js, then the minimal build. Inputs that do not fit
+ * in a wasm32 heap use the Memory64 build instead, where available. Modules with precomputed tables are initialized
+ * before being returned, which is immediate for snapshot builds.
  * @memberof WASMUtils
  * @param {string} moduleName - The name of the module to load.
+ * @param {Object} [options] - load options
+ * @param {boolean} [options.memory64=false] - whether the module must address more than 4 GB
+ * @param {boolean} [options.profiling=false] - whether to load the profiling build, keeping the C function names
  * @returns {Promise} A promise that resolves to the module.
  * @throws Will throw an error if there was an error loading the module.
  */
-const CModule = async (modName) => {
+const CModule = async (modName, { memory64 = false, profiling = false } = {}) => {
   try {
-    let { default: Module } = await import(_location("C", modName));
-    return Module();
+    const builds = (await availableBuilds())[modName] || [];
+    let module;
+    if (profiling && builds.includes("profiling")) {
+      let { default: Module } = await import(
+        new URL(`${availableScripts.C}/${modName}/${modName}.prof.js`, import.meta.url)
+      );
+      module = await Module();
+    } else if (memory64 && memory64Supported && builds.includes("memory64")) {
+      let { default: Module } = await import(
+        new URL(`${availableScripts.C}/${modName}/${modName}.m64.js`, import.meta.url)
+      );
+      module = await Module();
+    } else if (isNode && builds.includes("wasi")) {
+      module = await WASIModule(modName);
+    } else if (builds.includes("minimal")) {
+      module = await MinimalModule(modName);
+    } else {
+      let { default: Module } = await import(_location("C", modName));
+      module = await Module();
+    }
+    typeof module._hc_initialize === "function" ? module._hc_initialize() : null;
+    return module;
   } catch (error) {
     console.error(
       `There was an error pulling the following module: ${modName}`,
@@ -237,17 +279,18 @@ class AScriptUtils {
  * @memberof WASMUtils
  * @param {string} scriptName - The script name.
  * @param {string} moduleName - The module name.
+ * @param {Object} [options] - load options of the C modules, see CModule.
  * @returns {Promise<object>} - A promise that resolves to the loaded module.
  * @throws {NotFound} - If the module is not found in the available scripts.
  */
-const loadModule = async (scriptName, moduleName) => {
+const loadModule = async (scriptName, moduleName, options = {}) => {
   try {
     const myCurrentModule = await new Promise((resolve, reject) => {
       //Removes extension for each module
       resolve(
         scriptName === "AS"
           ? ASModule(moduleName.substring(0, moduleName.length - 5))
-          : CModule(moduleName.substring(0, moduleName.length - 3))
+          : CModule(moduleName.substring(0, moduleName.length - 3), options)
       );
     });
     return myCurrentModule;
@@ -260,9 +303,10 @@ const loadModule = async (scriptName, moduleName) => {
 /**
  * @description Retrieves all available modules.
  * @memberof WASMUtils
+ * @param {Object} [options] - load options of the C modules, see CModule.
  * @returns {Promise<object>} - A promise that resolves to an object containing all the available modules.
  */
-const getAllModules = async () => {
+const getAllModules = async (options = {}) => {
   let wasmMods = {};
   let availableMods;
   for (var sc of Object.keys(availableScripts)) {
@@ -273,7 +317,7 @@ const getAllModules = async () => {
     }
     wasmMods[sc] = {};
     for (var mod of availableMods) {
-      let stgMod = await loadModule(sc, mod);
+      let stgMod = await loadModule(sc, mod, options);
       wasmMods[sc][
         sc === "AS"
           ? mod.substring(0, mod.length - 5)
@@ -305,6 +349,26 @@ const avScripts = async () => {
   return main;
 };
 
+/**
+ * @description Version of the kernels of the engine, from the binaries of the modules. The hash of each C module is
+ * the one written into builds.json by the build script, or else the hash of its Emscripten binary, and the
+ * AssemblyScript modules are hashed as they are.
+ * @memberof WASMUtils
+ * @returns {Promise<string>} - A promise that resolves to the hash of the modules.
+ */
+const avVersion = async () => {
+  const { hashes = {} } = await availableBuilds();
+  const modules = await Promise.all(
+    Object.keys(CUtils).map((name) =>
+      hashes[name]
+        ? hashes[name]
+        : hashFiles([new URL(`${availableScripts.C}/${name}/${name}.wasm`, import.meta.url)])
+    )
+  );
+  modules.push(await hashFiles(Object.keys(ASUtils).map((name) => _location("AS", name))));
+  return hashContent(modules.join(":"));
+};
+
 /**
  * @description Filters the function keys of an object, excluding specific keys.
  * @memberof WASMUtils
@@ -326,6 +390,17 @@ function filterFunctionKeys(obj) {
     "asm",
     "_createMem",
     "_destroy",
+    "_hc_initialize",
+    "_hc_pointer_size",
+    "_hc_status",
+    "_hc_status_detail",
+    "_hc_last_stats",
+    "_hc_reset_stats",
+    "_hc_memory_reset",
+    "_hc_last_memory",
+    "_hc_stack_paint",
+    "_hc_stack_peak",
+    "memoryGrows",
     "HEAP8",
     "HEAP16",
     "HEAP32",
@@ -343,6 +418,8 @@ export {
   loadModule,
   AScriptUtils,
   ASModule,
+  CModule,
   availableScripts,
   avScripts,
+  avVersion,
 };
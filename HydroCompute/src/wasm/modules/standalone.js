@@ -0,0 +1,121 @@
+import { readBinary } from "../../core/utils/runtime.js";
+
+/**
+ * @namespace StandaloneUtils
+ * @description Loaders shared by the builds of the C modules that ship without the Emscripten runtime (the minimal
+ * and wasi profiles of C/build.sh). A loaded module exposes the same members used from the Emscripten modules
+ * (HEAPF32, _createMem, _destroy and the kernels prefixed by an underscore), so every build is run alike.
+ */
+
+/**
+ * @description Exports of the modules that are part of the runtime and not kernels.
+ * @memberof StandaloneUtils
+ */
+const runtimeExports = new Set(["memory", "_initialize", "stackSave", "stackRestore", "stackAlloc"]);
+
+/**
+ * @description Compiled modules by location, so workers instantiating a module again skip compilation.
+ * @memberof StandaloneUtils
+ */
+const compiled = new Map();
+
+let builds = null;
+
+/**
+ * @method availableBuilds
+ * @memberof StandaloneUtils
+ * @description Profiles compiled for each C module, as listed in C/builds.json by the build script. Modules missing
+ * from the list only have the Emscripten build. The hashes of the binaries of each module are kept under hashes.
+ * @returns {Promise<Object>} profiles by module name, and the hashes by module name
+ */
+export const availableBuilds = () => {
+  if (builds === null) {
+    builds = readBinary(new URL("./C/builds.json", import.meta.url))
+      .then((buffer) => JSON.parse(new TextDecoder().decode(buffer)))
+      .catch(() => ({}));
+  }
+  return builds;
+};
+
+/**
+ * @method buildLocation
+ * @memberof StandaloneUtils
+ * @param {String} modName - name of the C module
+ * @param {String} extension - extension of the build, e.g. wasi.wasm
+ * @returns {URL} location of the build
+ */
+export const buildLocation = (modName, extension) =>
+  new URL(`./C/${modName}/${modName}.${extension}`, import.meta.url);
+
+/**
+ * @method compileModule
+ * @memberof StandaloneUtils
+ * @param {URL} location - location of the binary
+ * @returns {Promise<WebAssembly.Module>} compiled module, shared by all the instances in the thread
+ */
+export const compileModule = async (location) => {
+  if (!compiled.has(location.href)) {
+    compiled.set(location.href, readBinary(location).then((buffer) => WebAssembly.compile(buffer)));
+  }
+  return compiled.get(location.href);
+};
+
+/**
+ * @method moduleInterface
+ * @memberof StandaloneUtils
+ * @description Wraps the exports of an instance with the interface of the Emscripten modules.
+ * @param {Object} exports - exports of the instance
+ * @returns {Object} module
+ */
+export const moduleInterface = (exports) => {
+  const module = {
+    //Views are recreated whenever the memory grows and detaches the previous buffer
+    get HEAPF32() {
+      return new Float32Array(exports.memory.buffer);
+    },
+    get HEAP32() {
+      return new Int32Array(exports.memory.buffer);
+    },
+    get HEAPU32() {
+      return new Uint32Array(exports.memory.buffer);
+    },
+    //memory.grow calls notified by the module, if its build notifies them
+    memoryGrows: 0,
+  };
+  for (const [name, value] of Object.entries(exports)) {
+    if (typeof value !== "function" || runtimeExports.has(name)) continue;
+    if (name.startsWith("_") || name.startsWith("emscripten_")) continue;
+    module[`_${name}`] = value;
+  }
+  return module;
+};
+
+/**
+ * @method MinimalModule
+ * @memberof StandaloneUtils
+ * @description Instantiates the minimal build of a C module, compiled without filesystem, stdio or runtime. The few
+ * imports left by the compiler are provided here: memory growth notifications are counted, and anything else traps,
+ * as only an abort can reach it.
+ * @param {String} modName - name of the C module
+ * @returns {Promise<Object>} module with the same interface as the Emscripten modules
+ */
+export const MinimalModule = async (modName) => {
+  const wasm = await compileModule(buildLocation(modName, "min.wasm")),
+    imports = {};
+  //Growth notifications arrive once the module is loaded, and are counted on it
+  let loaded = null;
+  for (const { module: namespace, name, kind } of WebAssembly.Module.imports(wasm)) {
+    if (kind !== "function") continue;
+    imports[namespace] = imports[namespace] || {};
+    imports[namespace][name] =
+      name === "emscripten_notify_memory_growth"
+        ? () => (loaded !== null ? (loaded.memoryGrows += 1) : null)
+        : () => {
+            throw new Error(`Module ${modName} aborted in ${namespace}.${name}.`);
+          };
+  }
+  const instance = await WebAssembly.instantiate(wasm, imports);
+  loaded = moduleInterface(instance.exports);
+  typeof instance.exports._initialize === "function" ? instance.exports._initialize() : null;
+  return loaded;
+};
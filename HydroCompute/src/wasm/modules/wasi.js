@@ -0,0 +1,24 @@
+import { buildLocation, compileModule, moduleInterface } from "./standalone.js";
+
+/**
+ * @namespace WASIUtils
+ * @description Loader of the standalone WASI builds of the C modules (see the wasi profile of C/build.sh). The
+ * builds export only their memory and the functions marked with HC_EXPORT, and are instantiated with the wasi
+ * module of Node.js instead of the Emscripten runtime.
+ */
+
+/**
+ * @method WASIModule
+ * @memberof WASIUtils
+ * @description Instantiates the WASI build of a C module.
+ * @param {String} modName - name of the C module
+ * @returns {Promise<Object>} module with the same interface as the Emscripten modules
+ */
+export const WASIModule = async (modName) => {
+  const { WASI } = process.getBuiltinModule("node:wasi"),
+    wasm = await compileModule(buildLocation(modName, "wasi.wasm")),
+    wasi = new WASI({ version: "preview1", returnOnExit: true }),
+    instance = await WebAssembly.instantiate(wasm, wasi.getImportObject());
+  wasi.initialize(instance);
+  return moduleInterface(instance.exports);
+};
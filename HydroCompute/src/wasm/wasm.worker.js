@@ -2,6 +2,69 @@ import { AScriptUtils, getAllModules } from "./modules/modules.js";
 import { getPerformanceMeasures } from "../core/utils/globalUtils.js";
 import { splits } from "../core/utils/splits.js";
 
+/**
+ * @description Largest heap available to the wasm32 builds, which grow up to 2 GB by default.
+ * @memberof Workers
+ */
+const WASM32_HEAP_BYTES = 2 * 1024 ** 3;
+
+/**
+ * @description Output length of the C kernels whose output is not as long as their input series, as given by
+ * hc_output_length in the native registry.
+ * @memberof Workers
+ */
+const outputLengths = {
+  //HC_MC_SIMULATIONS in hydrocompute.h
+  _monteCarlo_c: (n) => (n > 0 ? 10000 : 0),
+};
+
+/**
+ * @description Statistics of the last kernel run by the worker, sent back with its results.
+ * @memberof Workers
+ */
+let kernelStats = {};
+
+/**
+ * @method readStats
+ * @memberof Workers
+ * @description Reads the statistics of the last call of a C module (see hc_stats in hydrocompute.h). Modules built
+ * before hc_last_stats was added only report their status.
+ * @param {Object} module - Emscripten module
+ * @returns {Object} status, detail, iterations and converged, as far as the module reports them
+ */
+const readStats = (module) => {
+  if (typeof module._hc_last_stats === "function") {
+    const at = Number(module._hc_last_stats()) / 4,
+      [status, detail, iterations, converged] = module.HEAP32.subarray(at, at + 4);
+    return { status, detail, iterations, converged: converged !== 0 };
+  }
+  return typeof module._hc_status === "function"
+    ? { status: module._hc_status(), detail: module._hc_status_detail() }
+    : {};
+};
+
+/**
+ * @description Memory used by the last kernel run by the worker, sent back with its results.
+ * @memberof Workers
+ */
+let kernelMemory = {};
+
+/**
+ * @method readMemory
+ * @memberof Workers
+ * @description Reads the memory used by a C module since its last hc_memory_reset (see hc_memory_stats in
+ * hydrocompute.h). Modules built before hc_last_memory was added report nothing.
+ * @param {Object} module - Emscripten module
+ * @returns {Object} allocations, allocatedBytes, heapPeak and stackPeak in bytes
+ */
+const readMemory = (module) => {
+  if (typeof module._hc_last_memory !== "function") return {};
+  const at = Number(module._hc_last_memory()) / 4,
+    //64-bit counters, as low and high words
+    word = (i) => module.HEAPU32[at + 2 * i] + module.HEAP32[at + 2 * i + 1] * 2 ** 32;
+  return { allocations: word(0), allocatedBytes: word(1), heapPeak: word(3), stackPeak: word(4) };
+};
+
 /**
  * @description Web worker script for executing WASM computations. The worker script switches between the AS utils or C utils using the handleAS and handleC methods. 
  * @module WebWorker
@@ -10,8 +73,10 @@ import { splits } from "../core/utils/splits.js";
  */
 self.onmessage = async (e) => {
   performance.mark("start-script");
+  kernelStats = {};
+  kernelMemory = {};
   let { funcName, funcArgs = [], id, step, length, scriptName } = e.data;
-  let data = new Float32Array(e.data.data);
+  let data = new Float32Array(e.data.data, e.data.byteOffset || 0, e.data.elementCount);
   data = splits.split1DArray({ data: data, n: length });
   let scripts;
   let result = null;
@@ -19,8 +84,11 @@ self.onmessage = async (e) => {
     let { default: Module } = await import(`../../${scriptName}`);
     scripts = await Module();
   } else {
-    scripts = await getAllModules();
+    //Inputs, output and scratch must be resident together, larger runs need a Memory64 build
+    const heapBytes = (data.length + 1) * (data.length > 0 ? data[0].length : 0) * Float32Array.BYTES_PER_ELEMENT;
+    scripts = await getAllModules({ memory64: heapBytes > WASM32_HEAP_BYTES });
   }
+  performance.mark("loaded-script");
   try {
     if (scriptName !== undefined) {
       performance.mark("start-function");
@@ -54,6 +122,8 @@ self.onmessage = async (e) => {
         step,
         funcName,
         ...getPerformance,
+        stats: kernelStats,
+        memory: kernelMemory,
       },
       [result]
     );
@@ -84,6 +154,7 @@ self.onmessage = async (e) => {
 const handleAS = (moduleName, ref, data, mod, funcArgs) => {
   let views = new AScriptUtils(),
     stgResult = [];
+  const heapBefore = mod.memory ? mod.memory.buffer.byteLength : 0;
   funcArgs === null ? (funcArgs = []) : funcArgs;
   if (moduleName === "matrixUtils") {
     //THIS NEEDS TO CHANGE!
@@ -113,13 +184,17 @@ const handleAS = (moduleName, ref, data, mod, funcArgs) => {
       views.releaseP(mat1, mod);
     }
   } else {
-    let arr = views.lowerTypedArray(Float32Array, 4, 2, data, mod);
-    mod.__setArgumentsLength(funcArgs.length === 0 ? 1 : funcArgs.length);
-    funcArgs.unshift(arr);
+    //Series functions take the first input, as in the C modules
+    let arr = views.lowerTypedArray(Float32Array, 4, 2, data[0], mod);
+    mod.__setArgumentsLength(funcArgs.length + 1);
     performance.mark("start-function");
-    stgResult = views.liftTypedArray(Float32Array, ref(...funcArgs) >>> 0, mod);
+    stgResult = views.liftTypedArray(Float32Array, ref(arr, ...funcArgs) >>> 0, mod);
     performance.mark("end-function");
   }
+  if (mod.memory) {
+    const heapBytes = mod.memory.buffer.byteLength;
+    kernelMemory = { heapBytes, grownBytes: heapBytes - heapBefore };
+  }
   return stgResult.buffer;
 };
 
@@ -136,28 +211,39 @@ const handleC = (moduleName = null, functionName = null, data, module) => {
   let stgRes = null;
   let ptrs = [];
   let r_ptr = 0;
-  let outputData = null;
-  let d = null;
 
   const bytes = Float32Array.BYTES_PER_ELEMENT;
   let inputData = data;
   let inputCount = data.length;
 
+  //Inputs and output count towards the peak of the call
+  typeof module._hc_memory_reset === "function" ? module._hc_memory_reset() : null;
+  //Growth is read from the memory of the module itself. Minimal builds count the memory.grow calls they notify (see
+  //standalone.js), for the other builds a call that grew the heap counts once
+  const heapBefore = module.HEAPF32.buffer.byteLength,
+    growsBefore = module.memoryGrows || 0;
+
   try {
-    let len = inputData[0].length;
-    r_ptr = module._createMem(len * bytes);
+    let len = inputData[0].length,
+      outLen = functionName in outputLengths ? outputLengths[functionName](len) : len;
+    //Memory64 builds take sizes and return pointers as BigInts
+    const wide = typeof module._hc_pointer_size === "function" && module._hc_pointer_size() === 8,
+      size = (value) => (wide ? BigInt(value) : value);
+    r_ptr = module._createMem(size(outLen * bytes));
 
     // Allocate memory for input and output arrays
     for (let i = 0; i < inputCount; i++) {
-      ptrs.push(module._createMem(len * bytes));
+      ptrs.push(module._createMem(size(len * bytes)));
     }
 
     // Copy input data to memory
     for (let j = 0; j < ptrs.length; j++) {
-      module.HEAPF32.set(inputData[j], ptrs[j] / bytes);
+      module.HEAPF32.set(inputData[j], Number(ptrs[j]) / bytes);
     }
 
     // Call the C function and measure execution time
+    typeof module._hc_reset_stats === "function" ? module._hc_reset_stats() : null;
+    typeof module._hc_stack_paint === "function" ? module._hc_stack_paint() : null;
     performance.mark("start-function");
     if (moduleName === "matrixUtils_c") {
       module[functionName](...ptrs, r_ptr, Math.sqrt(len));
@@ -167,21 +253,32 @@ const handleC = (moduleName = null, functionName = null, data, module) => {
       module[functionName](...ptrs, r_ptr, len);
     }
     performance.mark("end-function");
+    //Kernels report diagnostics through their statistics instead of printing
+    kernelStats = { ...readStats(module), allocations: ptrs.length + 2 };
+    typeof module._hc_stack_peak === "function" ? module._hc_stack_peak() : null;
+    const heapBytes = module.HEAPF32.buffer.byteLength;
+    kernelMemory = {
+      heapBytes,
+      grownBytes: heapBytes - heapBefore,
+      grows: Math.max((module.memoryGrows || 0) - growsBefore, heapBytes > heapBefore ? 1 : 0),
+      ...readMemory(module),
+    };
+    //HC_OUT_OF_MEMORY in hydrocompute.h
+    if (kernelStats.status === 2) {
+      console.error(`Function ${functionName} ran out of memory.`);
+    }
 
-    // Copy result data from memory and clean up memory
-    d = Array.from(new Float32Array(module.HEAPF32.buffer, r_ptr, len));
-    //create a new view from the data and pass it as a buffer
-    outputData = new Float32Array(d);
-    stgRes = new ArrayBuffer(outputData.buffer.byteLength);
-    new Float32Array(stgRes).set(new Float32Array(outputData.buffer));
+    // Copy result data out of the module memory
+    stgRes = new Float32Array(module.HEAPF32.buffer, Number(r_ptr), outLen).slice().buffer;
   } finally {
     for (let k of ptrs) {
       module._destroy(k);
     }
     module._destroy(r_ptr);
-    outputData = [];
     r_ptr = null;
     // module._doMemCheck();
   }
   return stgRes;
 };
+
+export { handleAS, handleC };
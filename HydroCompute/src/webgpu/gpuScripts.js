@@ -1,4 +1,5 @@
 import * as scripts from "./utils/gslCode/gslScripts.js"
+import { hashFiles } from "../core/utils/memoize.js";
 
 /**
  * @namespace gpuScripts
@@ -25,4 +26,15 @@ export const gpuScripts = () =>{
       fun.set(func, fn)
     }
     return fun;
-  }
\ No newline at end of file
+  }
+
+/**
+ * Version of the kernels of the engine, the hash of the script files holding them.
+ * @memberof gpuScripts
+ * @member gpuVersion
+ * @returns {Promise<string>} - The hash of the scripts.
+ */
+export const gpuVersion = () =>
+  hashFiles([
+    new URL("./utils/gslCode/matrixUtils_gpu.js", import.meta.url),
+  ]);
@@ -43,7 +43,7 @@ self.onmessage = async (e) => {
     lays = [],
     groups = [],
     { funcName, funcArgs, id, step, data, scriptName, length } = e.data;
-  data = new Float32Array(data);
+  data = new Float32Array(data, e.data.byteOffset || 0, e.data.elementCount);
 
   let gslCode;
 
@@ -55,6 +55,7 @@ self.onmessage = async (e) => {
   } else {
     scripts = await import("./utils/gslCode/gslScripts.js");
   }
+  performance.mark("loaded-script");
 
   try {
     if (scriptName !== undefined) {
@@ -8,6 +8,8 @@ const archiver = require('archiver');
 const app = express();
 const uploadDir = path.join(__dirname, 'uploads');
 const outputDir = path.join(__dirname, 'output');
+// Folder holding hydrocompute.h and hc_memory.c, shared by every kernel
+const runtimeDir = process.env.HYDROCOMPUTE_C || path.join(__dirname, '..', 'HydroCompute', 'src', 'wasm', 'modules', 'C');
 
 // Create output and upload directories if they don't exist
 if (!fs.existsSync(uploadDir)) {
@@ -62,8 +64,9 @@ app.post('/compile', upload.array('files'), (req, res) => {
       const fileExtension = path.extname(filePath);
       const outputFilePath = path.join(outputDir, path.basename(filePath, fileExtension) + '.js'); // Change to .js for JS output
 
-      // Compile the file using Emscripten
-      const emscriptenCommand = `bash -c "emcc ${filePath} -O3 -o ${outputFilePath} -s MODULARIZE -s EXPORT_ES6=1 -s ALLOW_MEMORY_GROWTH=1"`;
+      // Compile the file using Emscripten, along with the allocator of the kernels
+      const memoryFilePath = path.join(runtimeDir, 'hc_memory.c');
+      const emscriptenCommand = `bash -c "emcc ${filePath} ${memoryFilePath} -I${runtimeDir} -O3 -o ${outputFilePath} -s MODULARIZE -s EXPORT_ES6=1 -s ALLOW_MEMORY_GROWTH=1"`;
       childProcess.exec(emscriptenCommand, (error, stdout, stderr) => {
         if (error) {
           console.error(`Error compiling ${filePath}: ${stderr}`);